@@ -0,0 +1,167 @@
+#include "ofxMultiSpeakerAmbisonics.h"
+#include "ofMath.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+//--------------------
+static float legendre( int aorder, float ax ) {
+    if( aorder == 1 ) return ax;
+    if( aorder == 2 ) return 0.5f * ( 3.0f * ax * ax - 1.0f );
+    if( aorder == 3 ) return 0.5f * ( 5.0f * ax * ax * ax - 3.0f * ax );
+    return 1.0f;
+}
+
+//--------------------
+static int getOrderForChannel( int aacn ) {
+    return (int)floorf( sqrtf( (float)aacn ) );
+}
+
+//--------------------
+void ofxMultiSpeakerAmbisonics::encode( float aazimuth, float aelevation, int aorder, float* aOut ) {
+    float taz = ofDegToRad( aazimuth );
+    float tel = ofDegToRad( aelevation );
+    float x = cosf( tel ) * cosf( taz );
+    float y = cosf( tel ) * sinf( taz );
+    float z = sinf( tel );
+
+    aOut[0] = 1.0f;
+    if( aorder < 1 ) return;
+    aOut[1] = y;
+    aOut[2] = z;
+    aOut[3] = x;
+    if( aorder < 2 ) return;
+    const float tsqrt3 = sqrtf( 3.0f );
+    aOut[4] = tsqrt3 * x * y;
+    aOut[5] = tsqrt3 * y * z;
+    aOut[6] = 0.5f * ( 3.0f * z * z - 1.0f );
+    aOut[7] = tsqrt3 * x * z;
+    aOut[8] = 0.5f * tsqrt3 * ( x * x - y * y );
+    if( aorder < 3 ) return;
+    const float tsqrt5_8 = sqrtf( 5.0f / 8.0f );
+    const float tsqrt15 = sqrtf( 15.0f );
+    const float tsqrt3_8 = sqrtf( 3.0f / 8.0f );
+    aOut[9]  = tsqrt5_8 * y * ( 3.0f * x * x - y * y );
+    aOut[10] = tsqrt15 * x * y * z;
+    aOut[11] = tsqrt3_8 * y * ( 5.0f * z * z - 1.0f );
+    aOut[12] = 0.5f * z * ( 5.0f * z * z - 3.0f );
+    aOut[13] = tsqrt3_8 * x * ( 5.0f * z * z - 1.0f );
+    aOut[14] = 0.5f * tsqrt15 * z * ( x * x - y * y );
+    aOut[15] = tsqrt5_8 * x * ( x * x - 3.0f * y * y );
+}
+
+//--------------------
+std::vector<ofxMultiSpeakerAmbisonics::Speaker> ofxMultiSpeakerAmbisonics::getDefaultSpeakers( FMOD_SPEAKERMODE amode ) {
+    // { channel, azimuth, elevation } in the channel order of the speaker mode //
+    std::vector<std::vector<float>> tlayout;
+    switch( amode ) {
+        case FMOD_SPEAKERMODE_MONO:
+            tlayout = { {0, 0, 0} };
+            break;
+        case FMOD_SPEAKERMODE_STEREO:
+            tlayout = { {0, 30, 0}, {1, -30, 0} };
+            break;
+        case FMOD_SPEAKERMODE_QUAD:
+            tlayout = { {0, 45, 0}, {1, -45, 0}, {2, 135, 0}, {3, -135, 0} };
+            break;
+        case FMOD_SPEAKERMODE_SURROUND:
+            tlayout = { {0, 30, 0}, {1, -30, 0}, {2, 0, 0}, {3, 110, 0}, {4, -110, 0} };
+            break;
+        case FMOD_SPEAKERMODE_5POINT1:
+            tlayout = { {0, 30, 0}, {1, -30, 0}, {2, 0, 0}, {4, 110, 0}, {5, -110, 0} };
+            break;
+        case FMOD_SPEAKERMODE_7POINT1POINT4:
+            // the height speakers, the 7.1 bed is added below //
+            tlayout = { {8, 45, 45}, {9, -45, 45}, {10, 135, 45}, {11, -135, 45} };
+            [[fallthrough]];
+        default:
+            std::vector<std::vector<float>> tbed = { {0, 30, 0}, {1, -30, 0}, {2, 0, 0}, {4, 90, 0}, {5, -90, 0}, {6, 150, 0}, {7, -150, 0} };
+            tlayout.insert( tlayout.begin(), tbed.begin(), tbed.end() );
+            break;
+    }
+
+    std::vector<Speaker> tspeakers;
+    for( auto& tentry : tlayout ) {
+        Speaker tspeaker;
+        tspeaker.channel = (int)tentry[0];
+        tspeaker.azimuth = tentry[1];
+        tspeaker.elevation = tentry[2];
+        tspeakers.push_back( tspeaker );
+    }
+    return tspeakers;
+}
+
+//--------------------
+std::vector<float> ofxMultiSpeakerAmbisonics::computeDecoder( const std::vector<Speaker>& aspeakers, int aorder, bool abMaxRE, int anumOutputChannels ) {
+    aorder = ofClamp( aorder, 0, MAX_ORDER );
+    int tnumChannels = getNumChannels( aorder );
+    std::vector<float> tdecoder( (size_t)std::max( anumOutputChannels, 0 ) * MAX_CHANNELS, 0.0f );
+
+    std::vector<Speaker> tspeakers;
+    for( auto& tspeaker : aspeakers ) {
+        if( tspeaker.channel >= 0 && tspeaker.channel < anumOutputChannels ) tspeakers.push_back( tspeaker );
+    }
+    if( tspeakers.empty() ) return tdecoder;
+
+    // max rE weights, legendre polynomials at the cosine of the spread angle for this order //
+    float tweights[MAX_ORDER+1] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    if( abMaxRE && aorder > 0 ) {
+        float tcos = cosf( ofDegToRad( 137.9f / ( (float)aorder + 1.51f ) ) );
+        for( int n = 0; n <= aorder; n++ ) {
+            tweights[n] = legendre( n, tcos );
+        }
+    }
+
+    // projecting with sn3d input needs the ( 2n + 1 ) factor of the n3d basis //
+    float tharmonics[MAX_CHANNELS];
+    float tinvNumSpeakers = 1.0f / (float)tspeakers.size();
+    for( auto& tspeaker : tspeakers ) {
+        encode( tspeaker.azimuth, tspeaker.elevation, aorder, tharmonics );
+        for( int k = 0; k < tnumChannels; k++ ) {
+            int n = getOrderForChannel( k );
+            tdecoder[tspeaker.channel * MAX_CHANNELS + k] += (float)( 2 * n + 1 ) * tweights[n] * tharmonics[k] * tinvNumSpeakers;
+        }
+    }
+
+    // scale so a source pointed at a speaker keeps the energy it had before encoding //
+    float tenergy = 0.0f;
+    for( auto& tsource : tspeakers ) {
+        encode( tsource.azimuth, tsource.elevation, aorder, tharmonics );
+        for( int o = 0; o < anumOutputChannels; o++ ) {
+            float tgain = 0.0f;
+            for( int k = 0; k < tnumChannels; k++ ) {
+                tgain += tdecoder[o * MAX_CHANNELS + k] * tharmonics[k];
+            }
+            tenergy += tgain * tgain;
+        }
+    }
+    tenergy *= tinvNumSpeakers;
+    if( tenergy > 0.0f ) {
+        float tscale = 1.0f / sqrtf( tenergy );
+        for( auto& tgain : tdecoder ) {
+            tgain *= tscale;
+        }
+    }
+    return tdecoder;
+}
+
+//--------------------
+void ofxMultiSpeakerAmbisonics::decode( const std::vector<float>& aDecoder, const float* aBus, int anumBusChannels, float* aOut, int anumOutputChannels, int anumFrames ) {
+    int tnumChannels = std::min( anumBusChannels, (int)MAX_CHANNELS );
+    int tnumDecoded = std::min( anumOutputChannels, (int)( aDecoder.size() / MAX_CHANNELS ) );
+    for( int i = 0; i < anumFrames; i++ ) {
+        const float* tin = aBus + (size_t)i * anumBusChannels;
+        float* tout = aOut + (size_t)i * anumOutputChannels;
+        for( int o = 0; o < anumOutputChannels; o++ ) {
+            float tsum = 0.0f;
+            if( o < tnumDecoded ) {
+                const float* trow = aDecoder.data() + o * MAX_CHANNELS;
+                for( int k = 0; k < tnumChannels; k++ ) {
+                    tsum += trow[k] * tin[k];
+                }
+            }
+            tout[o] = tsum;
+        }
+    }
+}
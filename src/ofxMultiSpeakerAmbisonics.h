@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ofConstants.h"
+
+extern "C" {
+#include "fmod.h"
+}
+
+// first to third order ambisonics, acn channel order with sn3d normalisation ( ambix ) //
+// sources are encoded to a fixed number of bus channels, one decoder renders the bus to the speakers //
+// directions are in degrees, azimuth counter clockwise from the front ( positive is left ), elevation positive is up //
+class ofxMultiSpeakerAmbisonics {
+public:
+
+    static const int MAX_ORDER = 3;
+    static const int MAX_CHANNELS = 16;
+
+    struct Speaker {
+        // output channel the speaker is fed from //
+        int channel = 0;
+        float azimuth = 0.0f;
+        float elevation = 0.0f;
+    };
+
+    struct Settings {
+        // 1 - 3, ( order + 1 )^2 bus channels //
+        int order = 1;
+        // empty = the standard layout of the speaker mode, see getDefaultSpeakers //
+        std::vector<Speaker> speakers;
+        // weights the orders for the smallest energy spread, sharper images on few speakers //
+        bool bMaxRE = true;
+    };
+
+    static int getNumChannels( int aorder ) { return (aorder+1) * (aorder+1); }
+
+    // fills getNumChannels( aorder ) gains //
+    static void encode( float aazimuth, float aelevation, int aorder, float* aOut );
+
+    // lfe is left out, it does not take part in the decode //
+    static std::vector<Speaker> getDefaultSpeakers( FMOD_SPEAKERMODE amode );
+
+    // sampling decoder, gains[ outputChannel * MAX_CHANNELS + acn ], scaled to keep the encoded energy //
+    static std::vector<float> computeDecoder( const std::vector<Speaker>& aspeakers, int aorder, bool abMaxRE, int anumOutputChannels );
+
+    // renders an interleaved bus to interleaved outputs, overwriting them //
+    static void decode( const std::vector<float>& aDecoder, const float* aBus, int anumBusChannels, float* aOut, int anumOutputChannels, int anumFrames );
+
+};
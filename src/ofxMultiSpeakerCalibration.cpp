@@ -0,0 +1,468 @@
+#include "ofxMultiSpeakerCalibration.h"
+#include "ofxMultiSpeakerSoundPlayer.h"
+#include "ofUtils.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+//--------------------
+void ofxMultiSpeakerCalibration::Fft::setup( int asize ) {
+    size = asize;
+    int tbits = 0;
+    while( (1 << tbits) < size ) tbits++;
+    bitReverse.assign( size, 0 );
+    for( int i = 0; i < size; i++ ) {
+        int trev = 0;
+        for( int b = 0; b < tbits; b++ ) {
+            if( i & (1 << b) ) trev |= 1 << (tbits - 1 - b);
+        }
+        bitReverse[i] = trev;
+    }
+    twiddles.resize( size / 2 );
+    for( int i = 0; i < size / 2; i++ ) {
+        double tangle = -2.0 * M_PI * (double)i / (double)size;
+        twiddles[i] = std::complex<float>( (float)cos(tangle), (float)sin(tangle) );
+    }
+}
+
+// in place, the inverse is not scaled //
+//--------------------
+void ofxMultiSpeakerCalibration::Fft::transform( std::complex<float>* adata, bool ainverse ) const {
+    for( int i = 0; i < size; i++ ) {
+        if( i < bitReverse[i] ) std::swap( adata[i], adata[bitReverse[i]] );
+    }
+    float tsign = ainverse ? -1.0f : 1.0f;
+    for( int tlen = 2; tlen <= size; tlen *= 2 ) {
+        int thalf = tlen / 2;
+        int tstep = size / tlen;
+        for( int i = 0; i < size; i += tlen ) {
+            for( int j = 0; j < thalf; j++ ) {
+                const std::complex<float>& tw = twiddles[j * tstep];
+                float twr = tw.real();
+                float twi = tw.imag() * tsign;
+                std::complex<float>& a = adata[i + j];
+                std::complex<float>& b = adata[i + j + thalf];
+                float vr = b.real() * twr - b.imag() * twi;
+                float vi = b.real() * twi + b.imag() * twr;
+                b = std::complex<float>( a.real() - vr, a.imag() - vi );
+                a = std::complex<float>( a.real() + vr, a.imag() + vi );
+            }
+        }
+    }
+}
+
+//--------------------
+ofxMultiSpeakerCalibration::ofxMultiSpeakerCalibration() {
+
+}
+
+//--------------------
+ofxMultiSpeakerCalibration::~ofxMultiSpeakerCalibration() {
+    close();
+}
+
+//--------------------
+bool ofxMultiSpeakerCalibration::setup( Settings asettings ) {
+    if( isSetup() ) {
+        close();
+    }
+
+    FMOD_SYSTEM* tsys = ofxMultiSpeakerSoundPlayer::getSystem();
+    FMOD_CHANNELGROUP* tgroup = ofxMultiSpeakerSoundPlayer::getMasterChannelGroup();
+    if( tsys == nullptr || tgroup == nullptr ) {
+        ofLogError("ofxMultiSpeakerCalibration :: setup : fmod is not initialized, call ofxMultiSpeakerSoundPlayer::initializeFmod() first");
+        return false;
+    }
+    mSettings = asettings;
+
+    FMOD_SPEAKERMODE tmode = FMOD_SPEAKERMODE_STEREO;
+    int tnumRaw = 0;
+    FMOD_System_GetSoftwareFormat(tsys, &mSampleRate, &tmode, &tnumRaw);
+    mNumChannels = 0;
+    if( tmode == FMOD_SPEAKERMODE_RAW ) {
+        mNumChannels = tnumRaw;
+    } else {
+        FMOD_System_GetSpeakerModeChannels(tsys, tmode, &mNumChannels);
+    }
+    mNumChannels = std::min( mNumChannels, (int)FMOD_MAX_CHANNEL_WIDTH );
+    mSpeakerMode = tmode;
+
+    unsigned int tblockSize = 0;
+    int tnumBuffers = 0;
+    FMOD_System_GetDSPBufferSize(tsys, &tblockSize, &tnumBuffers);
+    mBlockSize = (int)tblockSize;
+    if( mNumChannels < 1 || mSampleRate < 1 || mBlockSize < 1 || (mBlockSize & (mBlockSize - 1)) != 0 ) {
+        ofLogError("ofxMultiSpeakerCalibration :: setup : unsupported output format, channels: ") << mNumChannels << " rate: " << mSampleRate << " block size: " << mBlockSize;
+        return false;
+    }
+
+    // each fir partition is one block, convolved with a 2x block fft //
+    mFft.setup( mBlockSize * 2 );
+    mBlock.assign( mBlockSize, 0.0f );
+    mFftBuffer.assign( mBlockSize * 2, std::complex<float>(0.0f, 0.0f) );
+    mAccum.assign( mBlockSize + 1, std::complex<float>(0.0f, 0.0f) );
+    mFirLengths.assign( FMOD_MAX_CHANNEL_WIDTH, 0 );
+    mUnalignedBlocks = 0;
+
+    // room for the max delay plus the interpolation taps //
+    size_t tmaxDelay = (size_t)(std::max( mSettings.maxDelayMS, 0.0f ) * 0.001f * (float)mSampleRate) + 4;
+    mDelayLineSize = 1;
+    while( mDelayLineSize < tmaxDelay ) mDelayLineSize *= 2;
+
+    for( int i = 0; i < FMOD_MAX_CHANNEL_WIDTH; i++ ) {
+        ChannelState& tchannel = mChannels[i];
+        tchannel.gain = 1.0f;
+        tchannel.delaySamples = 0.0f;
+        tchannel.currentGain = 1.0f;
+        tchannel.delayLine.assign( i < mNumChannels ? mDelayLineSize : 0, 0.0f );
+        tchannel.delayWritePos = 0;
+    }
+
+    FMOD_DSP_DESCRIPTION tdesc;
+    memset( &tdesc, 0, sizeof(tdesc) );
+    tdesc.pluginsdkversion = FMOD_PLUGIN_SDK_VERSION;
+    strncpy( tdesc.name, "ofxMSCalibration", sizeof(tdesc.name)-1 );
+    tdesc.version = 1;
+    tdesc.numinputbuffers = 1;
+    tdesc.numoutputbuffers = 1;
+    tdesc.read = &ofxMultiSpeakerCalibration::dspRead;
+
+    FMOD_RESULT tresult = FMOD_System_CreateDSP(tsys, &tdesc, &mDsp);
+    if( tresult == FMOD_OK ) {
+        FMOD_DSP_SetUserData(mDsp, this);
+        tresult = FMOD_ChannelGroup_AddDSP(tgroup, FMOD_CHANNELCONTROL_DSP_HEAD, mDsp);
+    }
+    if( tresult != FMOD_OK ) {
+        ofLogError("ofxMultiSpeakerCalibration :: setup : unable to add calibration dsp to master group");
+        if( mDsp != nullptr ) {
+            FMOD_DSP_Release(mDsp);
+            mDsp = nullptr;
+        }
+        return false;
+    }
+    mChannelGroup = tgroup;
+
+    ofLogNotice("ofxMultiSpeakerCalibration :: setup : ") << mNumChannels << " channels, block size " << mBlockSize << " at " << mSampleRate;
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerCalibration::close() {
+    if( mDsp != nullptr ) {
+        if( ofxMultiSpeakerSoundPlayer::getSystem() != nullptr ) {
+            FMOD_ChannelGroup_RemoveDSP(mChannelGroup, mDsp);
+            FMOD_DSP_Release(mDsp);
+        }
+        mDsp = nullptr;
+    }
+    mChannelGroup = nullptr;
+
+    // the mixer thread is done with the dsp, so all of the filters can go //
+    for( int i = 0; i < FMOD_MAX_CHANNEL_WIDTH; i++ ) {
+        ChannelState& tchannel = mChannels[i];
+        delete tchannel.pendingFir.exchange( nullptr );
+        delete tchannel.retiredFir.exchange( nullptr );
+        delete tchannel.fir;
+        tchannel.fir = nullptr;
+    }
+    mFirLengths.clear();
+}
+
+//--------------------
+bool ofxMultiSpeakerCalibration::setSpeakerCalibration( FMOD_SPEAKER aspeaker, SpeakerCalibration acalibration ) {
+    if( getChannelIndex(aspeaker) < 0 ) return false;
+    setDelayMS( aspeaker, acalibration.delayMS );
+    setGain( aspeaker, acalibration.gain );
+    if( acalibration.firPath != "" ) {
+        return loadFir( aspeaker, acalibration.firPath, acalibration.firChannel );
+    }
+    clearFir( aspeaker );
+    return true;
+}
+
+//--------------------
+bool ofxMultiSpeakerCalibration::setDelayMS( FMOD_SPEAKER aspeaker, float adelayMS ) {
+    int tindex = getChannelIndex( aspeaker );
+    if( tindex < 0 ) return false;
+    float tmaxSamples = (float)(mDelayLineSize - 4);
+    float tsamples = adelayMS * 0.001f * (float)mSampleRate;
+    if( tsamples < 0.0f || tsamples > tmaxSamples ) {
+        ofLogWarning("ofxMultiSpeakerCalibration :: setDelayMS : delay ") << adelayMS << " out of range, max is " << mSettings.maxDelayMS;
+        tsamples = ofClamp( tsamples, 0.0f, tmaxSamples );
+    }
+    mChannels[tindex].delaySamples.store( tsamples );
+    return true;
+}
+
+//--------------------
+bool ofxMultiSpeakerCalibration::setGain( FMOD_SPEAKER aspeaker, float again ) {
+    int tindex = getChannelIndex( aspeaker );
+    if( tindex < 0 ) return false;
+    mChannels[tindex].gain.store( again );
+    return true;
+}
+
+//--------------------
+bool ofxMultiSpeakerCalibration::loadFir( FMOD_SPEAKER aspeaker, std::string aFilePath, int aFileChannel ) {
+    if( getChannelIndex(aspeaker) < 0 ) return false;
+
+    std::vector<float> tsamples;
+    int tnumChannels = 0;
+    float tsampleRate = 0;
+    if( !ofxMultiSpeakerSoundPlayer::loadPCMFloat( aFilePath, tsamples, tnumChannels, tsampleRate ) ) {
+        ofLogError("ofxMultiSpeakerCalibration :: loadFir : unable to load impulse response ") << aFilePath;
+        return false;
+    }
+    if( aFileChannel < 0 || aFileChannel >= tnumChannels ) {
+        ofLogWarning("ofxMultiSpeakerCalibration :: loadFir : channel ") << aFileChannel << " not in " << aFilePath << ", using channel 0";
+        aFileChannel = 0;
+    }
+    if( (int)tsampleRate != mSampleRate ) {
+        ofLogWarning("ofxMultiSpeakerCalibration :: loadFir : ") << aFilePath << " sample rate " << tsampleRate << " does not match the output rate " << mSampleRate;
+    }
+
+    std::vector<float> timpulse( tsamples.size() / tnumChannels );
+    for( size_t i = 0; i < timpulse.size(); i++ ) {
+        timpulse[i] = tsamples[i * tnumChannels + aFileChannel];
+    }
+    return setFir( aspeaker, timpulse );
+}
+
+//--------------------
+bool ofxMultiSpeakerCalibration::setFir( FMOD_SPEAKER aspeaker, const std::vector<float>& aImpulse ) {
+    int tindex = getChannelIndex( aspeaker );
+    if( tindex < 0 ) return false;
+    if( aImpulse.empty() ) {
+        clearFir( aspeaker );
+        return true;
+    }
+    if( (int)aImpulse.size() > mSettings.maxFirLength ) {
+        ofLogWarning("ofxMultiSpeakerCalibration :: setFir : impulse response of ") << aImpulse.size() << " samples truncated to " << mSettings.maxFirLength;
+    }
+    FirFilter* tfir = createFir( aImpulse );
+    // a filter the mixer never picked up can be deleted right away //
+    delete mChannels[tindex].pendingFir.exchange( tfir );
+    mFirLengths[tindex] = tfir->length;
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerCalibration::clearFir( FMOD_SPEAKER aspeaker ) {
+    int tindex = getChannelIndex( aspeaker );
+    if( tindex < 0 ) return;
+    delete mChannels[tindex].pendingFir.exchange( new FirFilter() );
+    mFirLengths[tindex] = 0;
+}
+
+//--------------------
+float ofxMultiSpeakerCalibration::getDelayMS( FMOD_SPEAKER aspeaker ) const {
+    int tindex = getChannelIndex( aspeaker );
+    if( tindex < 0 ) return 0.0f;
+    return mChannels[tindex].delaySamples.load() * 1000.0f / (float)mSampleRate;
+}
+
+//--------------------
+float ofxMultiSpeakerCalibration::getGain( FMOD_SPEAKER aspeaker ) const {
+    int tindex = getChannelIndex( aspeaker );
+    if( tindex < 0 ) return 1.0f;
+    return mChannels[tindex].gain.load();
+}
+
+//--------------------
+int ofxMultiSpeakerCalibration::getFirLength( FMOD_SPEAKER aspeaker ) const {
+    int tindex = getChannelIndex( aspeaker );
+    if( tindex < 0 ) return 0;
+    return mFirLengths[tindex];
+}
+
+//--------------------
+void ofxMultiSpeakerCalibration::update() {
+    for( int i = 0; i < FMOD_MAX_CHANNEL_WIDTH; i++ ) {
+        delete mChannels[i].retiredFir.exchange( nullptr );
+    }
+}
+
+//--------------------
+int ofxMultiSpeakerCalibration::getChannelIndex( FMOD_SPEAKER aspeaker ) const {
+    if( !isSetup() ) {
+        ofLogError("ofxMultiSpeakerCalibration :: call setup() before calibrating speakers");
+        return -1;
+    }
+    // raw outputs have no speaker layout, the speaker is used as the channel index //
+    int tindex = (int)aspeaker;
+    if( mSpeakerMode != FMOD_SPEAKERMODE_RAW ) {
+        tindex = ofxMultiSpeakerSoundPlayer::getSpeakerChannel( aspeaker, mSpeakerMode );
+    }
+    if( tindex < 0 || tindex >= mNumChannels ) {
+        ofLogError("ofxMultiSpeakerCalibration :: speaker ") << ofxMultiSpeakerSoundPlayer::getSpeakerName(aspeaker) << " is not in the output, speaker mode: " << (int)mSpeakerMode << " number of channels: " << mNumChannels;
+        return -1;
+    }
+    return tindex;
+}
+
+//--------------------
+ofxMultiSpeakerCalibration::FirFilter* ofxMultiSpeakerCalibration::createFir( const std::vector<float>& aImpulse ) {
+    FirFilter* tfir = new FirFilter();
+    int tbins = mBlockSize + 1;
+    tfir->length = std::min( (int)aImpulse.size(), mSettings.maxFirLength );
+    tfir->numPartitions = (tfir->length + mBlockSize - 1) / mBlockSize;
+    tfir->partitions.assign( (size_t)tfir->numPartitions * tbins, std::complex<float>(0.0f, 0.0f) );
+    tfir->fdl.assign( (size_t)tfir->numPartitions * tbins, std::complex<float>(0.0f, 0.0f) );
+    tfir->prevInput.assign( mBlockSize, 0.0f );
+
+    // zero padded partitions, only the bins up to nyquist are kept since the input is real //
+    std::vector<std::complex<float>> tbuffer( mBlockSize * 2 );
+    for( int p = 0; p < tfir->numPartitions; p++ ) {
+        std::fill( tbuffer.begin(), tbuffer.end(), std::complex<float>(0.0f, 0.0f) );
+        for( int i = 0; i < mBlockSize; i++ ) {
+            int tindex = p * mBlockSize + i;
+            if( tindex >= tfir->length ) break;
+            tbuffer[i] = std::complex<float>( aImpulse[tindex], 0.0f );
+        }
+        mFft.transform( tbuffer.data(), false );
+        std::copy( tbuffer.begin(), tbuffer.begin() + tbins, tfir->partitions.begin() + (size_t)p * tbins );
+    }
+    return tfir;
+}
+
+//--------------------
+FMOD_RESULT F_CALL ofxMultiSpeakerCalibration::dspRead( FMOD_DSP_STATE* dsp_state, float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int* outchannels ) {
+    void* tuserData = nullptr;
+    FMOD_DSP_GetUserData((FMOD_DSP*)dsp_state->instance, &tuserData);
+    ofxMultiSpeakerCalibration* tcalibration = (ofxMultiSpeakerCalibration*)tuserData;
+    if( tcalibration == nullptr ) {
+        memcpy( outbuffer, inbuffer, sizeof(float) * length * std::min(inchannels, *outchannels) );
+        return FMOD_OK;
+    }
+    tcalibration->process( inbuffer, outbuffer, length, inchannels, *outchannels );
+    return FMOD_OK;
+}
+
+// called from the mixer thread //
+//--------------------
+void ofxMultiSpeakerCalibration::process( float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int outchannels ) {
+    bool buseFir = (length % mBlockSize) == 0;
+    if( !buseFir ) {
+        mUnalignedBlocks.fetch_add( 1, std::memory_order_relaxed );
+    }
+    int tnumChannels = std::min( std::min(inchannels, outchannels), mNumChannels );
+
+    for( int c = 0; c < outchannels; c++ ) {
+        if( c >= tnumChannels ) {
+            // channels we do not know about pass straight through //
+            for( unsigned int i = 0; i < length; i++ ) {
+                outbuffer[i * outchannels + c] = c < inchannels ? inbuffer[i * inchannels + c] : 0.0f;
+            }
+            continue;
+        }
+
+        ChannelState& tchannel = mChannels[c];
+        // pick up a new filter, but only once the main thread has freed the last replaced one //
+        if( tchannel.retiredFir.load(std::memory_order_acquire) == nullptr ) {
+            FirFilter* tpending = tchannel.pendingFir.exchange( nullptr, std::memory_order_acq_rel );
+            if( tpending != nullptr ) {
+                tchannel.retiredFir.store( tchannel.fir, std::memory_order_release );
+                tchannel.fir = tpending;
+            }
+        }
+
+        for( unsigned int toffset = 0; toffset < length; toffset += mBlockSize ) {
+            int tnum = std::min( (int)(length - toffset), mBlockSize );
+            for( int i = 0; i < tnum; i++ ) {
+                mBlock[i] = inbuffer[(toffset + i) * inchannels + c];
+            }
+            processChannel( tchannel, mBlock.data(), tnum, buseFir && tnum == mBlockSize );
+            for( int i = 0; i < tnum; i++ ) {
+                outbuffer[(toffset + i) * outchannels + c] = mBlock[i];
+            }
+        }
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerCalibration::processChannel( ChannelState& achannel, float* ablock, int alength, bool abUseFir ) {
+    // delay, lagrange interpolated for fractional sample delays //
+    float tdelay = achannel.delaySamples.load( std::memory_order_relaxed );
+    int tdelayInt = (int)tdelay;
+    float tfrac = tdelay - (float)tdelayInt;
+    size_t tmask = mDelayLineSize - 1;
+    std::vector<float>& tline = achannel.delayLine;
+    for( int i = 0; i < alength; i++ ) {
+        size_t twrite = achannel.delayWritePos;
+        tline[twrite] = ablock[i];
+        achannel.delayWritePos = (twrite + 1) & tmask;
+        if( tfrac < 1e-5f ) {
+            ablock[i] = tline[(twrite - tdelayInt) & tmask];
+        } else if( tdelayInt < 1 ) {
+            ablock[i] = (1.0f - tfrac) * tline[twrite] + tfrac * tline[(twrite - 1) & tmask];
+        } else {
+            float xm1 = tline[(twrite - tdelayInt + 1) & tmask];
+            float x0 = tline[(twrite - tdelayInt) & tmask];
+            float x1 = tline[(twrite - tdelayInt - 1) & tmask];
+            float x2 = tline[(twrite - tdelayInt - 2) & tmask];
+            float f = tfrac;
+            ablock[i] = -f * (f - 1.0f) * (f - 2.0f) / 6.0f * xm1
+                + (f + 1.0f) * (f - 1.0f) * (f - 2.0f) * 0.5f * x0
+                - (f + 1.0f) * f * (f - 2.0f) * 0.5f * x1
+                + (f + 1.0f) * f * (f - 1.0f) / 6.0f * x2;
+        }
+    }
+
+    if( abUseFir && achannel.fir != nullptr && achannel.fir->numPartitions > 0 ) {
+        convolve( *achannel.fir, ablock );
+    }
+
+    // ramp to the new gain over the block to avoid clicks //
+    float ttarget = achannel.gain.load( std::memory_order_relaxed );
+    float tgain = achannel.currentGain;
+    float tstep = (ttarget - tgain) / (float)alength;
+    for( int i = 0; i < alength; i++ ) {
+        tgain += tstep;
+        ablock[i] *= tgain;
+    }
+    achannel.currentGain = ttarget;
+}
+
+// uniformly partitioned overlap save, one block in and one block out //
+//--------------------
+void ofxMultiSpeakerCalibration::convolve( FirFilter& afir, float* ablock ) {
+    int tbins = mBlockSize + 1;
+    int tfftSize = mBlockSize * 2;
+    std::complex<float>* tbuffer = mFftBuffer.data();
+
+    for( int i = 0; i < mBlockSize; i++ ) {
+        tbuffer[i] = std::complex<float>( afir.prevInput[i], 0.0f );
+        tbuffer[mBlockSize + i] = std::complex<float>( ablock[i], 0.0f );
+        afir.prevInput[i] = ablock[i];
+    }
+    mFft.transform( tbuffer, false );
+    std::copy( tbuffer, tbuffer + tbins, afir.fdl.begin() + (size_t)afir.fdlPos * tbins );
+
+    std::fill( mAccum.begin(), mAccum.end(), std::complex<float>(0.0f, 0.0f) );
+    float* tacc = reinterpret_cast<float*>( mAccum.data() );
+    for( int p = 0; p < afir.numPartitions; p++ ) {
+        int tslot = (afir.fdlPos - p + afir.numPartitions) % afir.numPartitions;
+        const float* tx = reinterpret_cast<const float*>( &afir.fdl[(size_t)tslot * tbins] );
+        const float* th = reinterpret_cast<const float*>( &afir.partitions[(size_t)p * tbins] );
+        for( int k = 0; k < tbins * 2; k += 2 ) {
+            tacc[k]   += tx[k] * th[k]   - tx[k+1] * th[k+1];
+            tacc[k+1] += tx[k] * th[k+1] + tx[k+1] * th[k];
+        }
+    }
+    afir.fdlPos = (afir.fdlPos + 1) % afir.numPartitions;
+
+    // rebuild the conjugate symmetric upper half for the inverse //
+    for( int k = 0; k < tbins; k++ ) {
+        tbuffer[k] = mAccum[k];
+    }
+    for( int k = 1; k < mBlockSize; k++ ) {
+        tbuffer[tfftSize - k] = std::conj( mAccum[k] );
+    }
+    mFft.transform( tbuffer, true );
+
+    float tscale = 1.0f / (float)tfftSize;
+    for( int i = 0; i < mBlockSize; i++ ) {
+        ablock[i] = tbuffer[mBlockSize + i].real() * tscale;
+    }
+}
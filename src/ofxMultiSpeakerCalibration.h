@@ -0,0 +1,126 @@
+#pragma once
+
+#include "ofConstants.h"
+
+#include <atomic>
+#include <complex>
+
+extern "C" {
+#include "fmod.h"
+}
+
+// per speaker delay, gain trim and fir room correction on the master output //
+// runs as a dsp on the master channel group, firs use uniformly partitioned fft convolution //
+// with a partition size equal to the fmod dsp buffer size, so there is no added latency //
+class ofxMultiSpeakerCalibration {
+public:
+
+    struct Settings {
+        // longest delay that can be set on a speaker //
+        float maxDelayMS = 100.0f;
+        // impulse responses longer than this are truncated //
+        int maxFirLength = 32768;
+    };
+
+    struct SpeakerCalibration {
+        float delayMS = 0.0f;
+        float gain = 1.0f;
+        // impulse response file, any format fmod can open, empty = no fir //
+        std::string firPath = "";
+        // channel to use from a multichannel impulse response file //
+        int firChannel = 0;
+    };
+
+    ofxMultiSpeakerCalibration();
+    ~ofxMultiSpeakerCalibration();
+
+    // fmod needs to be initialized, adds the calibration dsp to the master channel group //
+    bool setup( Settings asettings );
+    bool setup() { return setup( Settings() ); }
+    void close();
+    bool isSetup() const { return mDsp != nullptr; }
+
+    bool setSpeakerCalibration( FMOD_SPEAKER aspeaker, SpeakerCalibration acalibration );
+    bool setDelayMS( FMOD_SPEAKER aspeaker, float adelayMS );
+    bool setGain( FMOD_SPEAKER aspeaker, float again );
+    bool loadFir( FMOD_SPEAKER aspeaker, std::string aFilePath, int aFileChannel = 0 );
+    // impulse response at the fmod output sample rate //
+    bool setFir( FMOD_SPEAKER aspeaker, const std::vector<float>& aImpulse );
+    void clearFir( FMOD_SPEAKER aspeaker );
+
+    float getDelayMS( FMOD_SPEAKER aspeaker ) const;
+    float getGain( FMOD_SPEAKER aspeaker ) const;
+    int getFirLength( FMOD_SPEAKER aspeaker ) const;
+
+    // frees filters replaced on the mixer thread, call from the main thread, ie. in ofApp::update //
+    void update();
+
+    int getNumChannels() const { return mNumChannels; }
+    int getBlockSize() const { return mBlockSize; }
+    // mix blocks that were not a multiple of the block size and skipped the fir //
+    uint64_t getNumUnalignedBlocks() const { return mUnalignedBlocks.load(); }
+
+protected:
+
+    // radix 2 complex fft, tables are only written in setup //
+    struct Fft {
+        int size = 0;
+        std::vector<int> bitReverse;
+        std::vector<std::complex<float>> twiddles;
+        void setup( int asize );
+        void transform( std::complex<float>* adata, bool ainverse ) const;
+    };
+
+    // partitioned filter spectra plus the frequency domain delay line that goes with them //
+    struct FirFilter {
+        int length = 0;
+        int numPartitions = 0;
+        // numPartitions * ( blockSize + 1 ) bins //
+        std::vector<std::complex<float>> partitions;
+        std::vector<std::complex<float>> fdl;
+        int fdlPos = 0;
+        // last block of input, the first half of the next fft //
+        std::vector<float> prevInput;
+    };
+
+    struct ChannelState {
+        std::atomic<float> gain{1.0f};
+        std::atomic<float> delaySamples{0.0f};
+        std::atomic<FirFilter*> pendingFir{nullptr};
+        std::atomic<FirFilter*> retiredFir{nullptr};
+        // only touched on the mixer thread //
+        FirFilter* fir = nullptr;
+        float currentGain = 1.0f;
+        std::vector<float> delayLine;
+        size_t delayWritePos = 0;
+    };
+
+    static FMOD_RESULT F_CALL dspRead( FMOD_DSP_STATE* dsp_state, float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int* outchannels );
+
+    void process( float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int outchannels );
+    void processChannel( ChannelState& achannel, float* ablock, int alength, bool abUseFir );
+    void convolve( FirFilter& afir, float* ablock );
+    FirFilter* createFir( const std::vector<float>& aImpulse );
+    int getChannelIndex( FMOD_SPEAKER aspeaker ) const;
+
+    Settings mSettings;
+    int mNumChannels = 0;
+    FMOD_SPEAKERMODE mSpeakerMode = FMOD_SPEAKERMODE_STEREO;
+    int mSampleRate = 0;
+    int mBlockSize = 0;
+    size_t mDelayLineSize = 0;
+    FMOD_DSP* mDsp = nullptr;
+    FMOD_CHANNELGROUP* mChannelGroup = nullptr;
+
+    Fft mFft;
+    ChannelState mChannels[FMOD_MAX_CHANNEL_WIDTH];
+    std::vector<int> mFirLengths;
+
+    // mixer thread scratch //
+    std::vector<float> mBlock;
+    std::vector<std::complex<float>> mFftBuffer;
+    std::vector<std::complex<float>> mAccum;
+
+    std::atomic<uint64_t> mUnalignedBlocks{0};
+
+};
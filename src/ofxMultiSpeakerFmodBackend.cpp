@@ -0,0 +1,231 @@
+#include "ofxMultiSpeakerFmodBackend.h"
+#include "ofxMultiSpeakerSoundPlayer.h"
+#include "ofxMultiSpeakerTrace.h"
+#include "ofLog.h"
+
+//--------------------
+ofxMultiSpeakerFmodBackend::~ofxMultiSpeakerFmodBackend() {
+    unload();
+}
+
+//--------------------
+bool ofxMultiSpeakerFmodBackend::load( std::string apath, bool abStream ) {
+    unload();
+    FMOD_SYSTEM* tsys = ofxMultiSpeakerSoundPlayer::getSystem();
+    if( tsys == nullptr ) return false;
+
+    //choose if we want streaming
+    int fmodFlags =  FMOD_DEFAULT;
+    if(abStream)fmodFlags =  FMOD_DEFAULT | FMOD_CREATESTREAM;
+
+    if( OFX_MS_TRACE_FMOD( FMOD_System_CreateSound(tsys, apath.c_str(), fmodFlags, NULL, &mSound) ) != FMOD_OK ) {
+        mSound = nullptr;
+        return false;
+    }
+    OFX_MS_TRACE_FMOD( FMOD_Sound_GetLength(mSound, &mLength, FMOD_TIMEUNIT_PCM) );
+    mNumChannels = 1;
+    OFX_MS_TRACE_FMOD( FMOD_Sound_GetFormat(mSound, NULL, NULL, &mNumChannels, NULL) );
+    mBStreaming = abStream;
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::unload() {
+    if( mSound == nullptr ) return;
+    stop();
+    if( !mBStreaming ) {
+        OFX_MS_TRACE_FMOD( FMOD_Sound_Release(mSound) );
+    }
+    mSound = nullptr;
+    mChannel = nullptr;
+    mLength = 0;
+}
+
+//--------------------
+bool ofxMultiSpeakerFmodBackend::open( bool abStopPrevious, bool abAmbisonic ) {
+    if( abStopPrevious ) {
+        OFX_MS_TRACE_FMOD( FMOD_Channel_Stop(mChannel) );
+    }
+    FMOD_CHANNELGROUP* tgroup = abAmbisonic ? ofxMultiSpeakerSoundPlayer::getAmbisonicBusGroup() : ofxMultiSpeakerSoundPlayer::getMasterChannelGroup();
+    if( OFX_MS_TRACE_FMOD( FMOD_System_PlaySound(ofxMultiSpeakerSoundPlayer::getSystem(), mSound, tgroup, true, &mChannel) ) != FMOD_OK ) {
+        mChannel = nullptr;
+        return false;
+    }
+    OFX_MS_TRACE_FMOD( FMOD_Channel_GetFrequency(mChannel, &mChannelFreq) );
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::update() {
+    FMOD_SYSTEM* tsys = ofxMultiSpeakerSoundPlayer::getSystem();
+    if( tsys != nullptr ) {
+        OFX_MS_TRACE_FMOD( FMOD_System_Update(tsys) );
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::stop() {
+    OFX_MS_TRACE_FMOD( FMOD_Channel_Stop(mChannel) );
+}
+
+//--------------------
+bool ofxMultiSpeakerFmodBackend::isPlaying() const {
+    if( mChannel == nullptr ) return false;
+    int playing = 0;
+    OFX_MS_TRACE_FMOD( FMOD_Channel_IsPlaying(mChannel, &playing) );
+    return playing != 0;
+}
+
+//--------------------
+bool ofxMultiSpeakerFmodBackend::isReady() const {
+    if( !mBStreaming ) return true;
+    FMOD_OPENSTATE tstate = FMOD_OPENSTATE_READY;
+    OFX_MS_TRACE_FMOD( FMOD_Sound_GetOpenState(mSound, &tstate, NULL, NULL, NULL) );
+    return tstate == FMOD_OPENSTATE_READY || tstate == FMOD_OPENSTATE_PLAYING;
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setPaused( bool ab ) {
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetPaused(mChannel, ab) );
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setVolume( float again ) {
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetVolume(mChannel, again) );
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setSpeed( float aspeed ) {
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetFrequency(mChannel, mChannelFreq * aspeed) );
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setLoop( bool ab ) {
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetMode(mChannel, ab ? FMOD_LOOP_NORMAL : FMOD_LOOP_OFF) );
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setPriority( int apriority ) {
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetPriority(mChannel, apriority) );
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setPosition( unsigned int aframe ) {
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetPosition(mChannel, aframe, FMOD_TIMEUNIT_PCM) );
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setPositionMS( int ams ) {
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetPosition(mChannel, ams, FMOD_TIMEUNIT_MS) );
+}
+
+//--------------------
+unsigned int ofxMultiSpeakerFmodBackend::getPosition() const {
+    unsigned int tposition = 0;
+    OFX_MS_TRACE_FMOD( FMOD_Channel_GetPosition(mChannel, &tposition, FMOD_TIMEUNIT_PCM) );
+    return tposition;
+}
+
+//--------------------
+int ofxMultiSpeakerFmodBackend::getPositionMS() const {
+    unsigned int tposition = 0;
+    OFX_MS_TRACE_FMOD( FMOD_Channel_GetPosition(mChannel, &tposition, FMOD_TIMEUNIT_MS) );
+    return (int)tposition;
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setStereoPan( float apan ) {
+    FMOD_RESULT result = OFX_MS_TRACE_FMOD( FMOD_Channel_SetPan(mChannel, apan) );
+    if (result != FMOD_OK) {
+        ofLogError("ofxMultiSpeakerSoundPlayer :: setPan : FMOD_Channel_SetPan - ERROR");
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setSpeakerGains( const float* aspeakerGains ) {
+    //FMOD_RESULT F_API FMOD_Channel_SetMixLevelsOutput (
+    //    FMOD_CHANNEL *channel,
+    //    float frontleft,
+    //    float frontright,
+    //    float center,
+    //    float lfe, --> Volume level for the subwoofer speaker.
+    //    float surroundleft,
+    //    float surroundright,
+    //    float backleft,
+    //    float backright
+    //);
+    FMOD_RESULT result = OFX_MS_TRACE_FMOD( FMOD_Channel_SetMixLevelsOutput(
+        mChannel,
+        aspeakerGains[0],
+        aspeakerGains[1],
+        aspeakerGains[2],
+        aspeakerGains[3],
+        aspeakerGains[4],
+        aspeakerGains[5],
+        aspeakerGains[6],
+        aspeakerGains[7]
+    ) );
+
+    if (result != FMOD_OK) {
+        ofLogError("ofxMultiSpeakerSoundPlayer :: setPan : FMOD_Channel_SetMixLevelsOutput - ERROR");
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setAmbisonicGains( const float* again, int anumBusChannels, int anumChannels ) {
+    // rows are the acn channels of the bus, columns the channels of the file //
+    FMOD_RESULT result = OFX_MS_TRACE_FMOD( FMOD_Channel_SetMixMatrix(mChannel, const_cast<float*>(again), anumBusChannels, anumChannels, anumChannels) );
+    if (result != FMOD_OK) {
+        ofLogError("ofxMultiSpeakerSoundPlayer :: setPan : FMOD_Channel_SetMixMatrix - ERROR");
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::setAmbisonic( bool ab ) {
+    FMOD_CHANNELGROUP* tgroup = ab ? ofxMultiSpeakerSoundPlayer::getAmbisonicBusGroup() : ofxMultiSpeakerSoundPlayer::getMasterChannelGroup();
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetChannelGroup(mChannel, tgroup) );
+}
+
+//--------------------
+int ofxMultiSpeakerFmodBackend::getAmbisonicOrder() const {
+    return ofxMultiSpeakerSoundPlayer::getAmbisonicBusOrder();
+}
+
+//--------------------
+int ofxMultiSpeakerFmodBackend::getNumOutputs() const {
+    FMOD_SPEAKERMODE tmode = ofxMultiSpeakerSoundPlayer::getFmodSettings().speakerMode;
+    if( tmode == FMOD_SPEAKERMODE_MONO ) return 1;
+    if( tmode == FMOD_SPEAKERMODE_STEREO ) return 2;
+    return 8;
+}
+
+//--------------------
+void ofxMultiSpeakerFmodBackend::startAt( unsigned long long aclock ) {
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetDelay(mChannel, aclock, 0, false) );
+    OFX_MS_TRACE_FMOD( FMOD_Channel_SetPaused(mChannel, false) );
+}
+
+//--------------------
+const void* ofxMultiSpeakerFmodBackend::getClockDomain() const {
+    return ofxMultiSpeakerSoundPlayer::getMasterChannelGroup();
+}
+
+//--------------------
+unsigned long long ofxMultiSpeakerFmodBackend::getClock() const {
+    unsigned long long tclock = 0;
+    FMOD_CHANNELGROUP* tgroup = ofxMultiSpeakerSoundPlayer::getMasterChannelGroup();
+    if( tgroup != nullptr ) {
+        OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_GetDSPClock(tgroup, &tclock, NULL) );
+    }
+    return tclock;
+}
+
+//--------------------
+int ofxMultiSpeakerFmodBackend::getClockRate() const {
+    int trate = 0;
+    FMOD_SYSTEM* tsys = ofxMultiSpeakerSoundPlayer::getSystem();
+    if( tsys != nullptr ) {
+        OFX_MS_TRACE_FMOD( FMOD_System_GetSoftwareFormat(tsys, &trate, NULL, NULL) );
+    }
+    return trate > 0 ? trate : ofxMultiSpeakerSoundPlayer::getFmodSettings().sampleRate;
+}
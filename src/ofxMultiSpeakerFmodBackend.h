@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ofxMultiSpeakerPlayerBackend.h"
+
+// plays the file on the shared fmod system of ofxMultiSpeakerSoundPlayer, initializeFmod() has to be called first //
+// every call goes straight to the channel, so commit() has nothing to do //
+class ofxMultiSpeakerFmodBackend : public ofxMultiSpeakerPlayerBackend {
+public:
+    ofxMultiSpeakerFmodBackend() {}
+    ~ofxMultiSpeakerFmodBackend();
+
+    bool load( std::string apath, bool abStream ) override;
+    void unload() override;
+    unsigned int getLength() const override { return mLength; }
+    int getNumChannels() const override { return mNumChannels; }
+    bool isStreaming() const override { return mBStreaming; }
+
+    bool open( bool abStopPrevious, bool abAmbisonic ) override;
+    void update() override;
+    void stop() override;
+    bool isPlaying() const override;
+    bool isReady() const override;
+
+    void setPaused( bool ab ) override;
+    void setVolume( float again ) override;
+    void setSpeed( float aspeed ) override;
+    void setLoop( bool ab ) override;
+    void setPriority( int apriority ) override;
+    void setPosition( unsigned int aframe ) override;
+    void setPositionMS( int ams ) override;
+    unsigned int getPosition() const override;
+    int getPositionMS() const override;
+
+    void setStereoPan( float apan ) override;
+    void setSpeakerGains( const float* aspeakerGains ) override;
+    void setAmbisonicGains( const float* again, int anumBusChannels, int anumChannels ) override;
+    void setAmbisonic( bool ab ) override;
+    int getAmbisonicOrder() const override;
+    // FMOD_Channel_SetMixLevelsOutput takes eight levels, mono and stereo speaker modes only reach the front //
+    int getNumOutputs() const override;
+
+    void startAt( unsigned long long aclock ) override;
+    const void* getClockDomain() const override;
+    unsigned long long getClock() const override;
+    int getClockRate() const override;
+
+    FMOD_CHANNEL* getChannel() const override { return mChannel; }
+    FMOD_SOUND* getSound() const override { return mSound; }
+
+protected:
+    FMOD_SOUND* mSound = nullptr;
+    FMOD_CHANNEL* mChannel = nullptr;
+    bool mBStreaming = false;
+    unsigned int mLength = 0;
+    int mNumChannels = 1;
+    // frequency of the channel when it was opened, speed scales it //
+    float mChannelFreq = 44100;
+
+};
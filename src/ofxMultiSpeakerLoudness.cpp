@@ -0,0 +1,479 @@
+#include "ofxMultiSpeakerLoudness.h"
+#include "ofxMultiSpeakerSoundPlayer.h"
+#include "ofUtils.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+static const int LOUDNESS_CACHE_VERSION = 1;
+// 4x oversampling for the true peak, 12 taps per phase //
+static const int TRUE_PEAK_PHASES = 4;
+static const int TRUE_PEAK_TAPS = 12;
+
+// direct form 1 biquad, doubles keep the low shelf stable at high sample rates //
+struct LoudnessBiquad {
+    double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    inline double process( double x ) {
+        double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1; x1 = x;
+        y2 = y1; y1 = y;
+        return y;
+    }
+};
+
+//--------------------
+static void setupKWeighting( LoudnessBiquad& aShelf, LoudnessBiquad& aHighPass, double asampleRate ) {
+    // BS.1770 pre filter and rlb filter, redesigned for any sample rate //
+    double f0 = 1681.974450955533;
+    double G = 3.999843853973347;
+    double Q = 0.7071752369554196;
+    double K = tan( M_PI * f0 / asampleRate );
+    double Vh = pow( 10.0, G / 20.0 );
+    double Vb = pow( Vh, 0.4996667741545416 );
+    double a0 = 1.0 + K / Q + K * K;
+    aShelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+    aShelf.b1 = 2.0 * (K * K - Vh) / a0;
+    aShelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+    aShelf.a1 = 2.0 * (K * K - 1.0) / a0;
+    aShelf.a2 = (1.0 - K / Q + K * K) / a0;
+
+    f0 = 38.13547087602444;
+    Q = 0.5003270373238773;
+    K = tan( M_PI * f0 / asampleRate );
+    a0 = 1.0 + K / Q + K * K;
+    aHighPass.b0 = 1.0;
+    aHighPass.b1 = -2.0;
+    aHighPass.b2 = 1.0;
+    aHighPass.a1 = 2.0 * (K * K - 1.0) / a0;
+    aHighPass.a2 = (1.0 - K / Q + K * K) / a0;
+}
+
+//--------------------
+static const std::vector<float>& getTruePeakCoefficients() {
+    // hann windowed sinc, laid out by phase //
+    static const std::vector<float> sCoefficients = []() {
+        int tnum = TRUE_PEAK_PHASES * TRUE_PEAK_TAPS;
+        std::vector<float> tcoeffs( tnum, 0.0f );
+        double tcenter = (double)(tnum - 1) * 0.5;
+        for( int i = 0; i < tnum; i++ ) {
+            double t = ((double)i - tcenter) / (double)TRUE_PEAK_PHASES;
+            double tsinc = fabs(t) < 1e-9 ? 1.0 : sin( M_PI * t ) / ( M_PI * t );
+            double twindow = 0.5 - 0.5 * cos( 2.0 * M_PI * (double)(i + 1) / (double)(tnum + 1) );
+            int tphase = i % TRUE_PEAK_PHASES;
+            int ttap = i / TRUE_PEAK_PHASES;
+            tcoeffs[tphase * TRUE_PEAK_TAPS + ttap] = (float)(tsinc * twindow);
+        }
+        return tcoeffs;
+    }();
+    return sCoefficients;
+}
+
+//--------------------
+static float toDB( double alinear ) {
+    if( alinear <= 1e-12 ) return -144.0f;
+    return (float)(20.0 * log10( alinear ));
+}
+
+//--------------------
+ofxMultiSpeakerLoudness::ofxMultiSpeakerLoudness() {
+
+}
+
+//--------------------
+ofxMultiSpeakerLoudness::~ofxMultiSpeakerLoudness() {
+    close();
+}
+
+//--------------------
+bool ofxMultiSpeakerLoudness::setup( Settings asettings ) {
+    close();
+    mSettings = asettings;
+    mSettings.numThreads = std::max( mSettings.numThreads, 1 );
+
+    if( FMOD_System_Create(&mDecodeSys) != FMOD_OK ) {
+        ofLogError("ofxMultiSpeakerLoudness :: setup : unable to create decode system");
+        mDecodeSys = nullptr;
+        return false;
+    }
+    // no output and no mixer thread, the system is only used to open and decode files //
+    FMOD_System_SetOutput(mDecodeSys, FMOD_OUTPUTTYPE_NOSOUND_NRT);
+    if( FMOD_System_Init(mDecodeSys, 1, FMOD_INIT_NORMAL, NULL) != FMOD_OK ) {
+        ofLogError("ofxMultiSpeakerLoudness :: setup : unable to init decode system");
+        FMOD_System_Release(mDecodeSys);
+        mDecodeSys = nullptr;
+        return false;
+    }
+
+    mBRunning = true;
+    for( int i = 0; i < mSettings.numThreads; i++ ) {
+        mThreads.push_back( std::thread( &ofxMultiSpeakerLoudness::workerThread, this ) );
+    }
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerLoudness::close() {
+    {
+        std::unique_lock<std::mutex> tlock( mMutex );
+        mBRunning = false;
+        mQueue.clear();
+        mPending.clear();
+    }
+    mCondition.notify_all();
+    for( auto& tthread : mThreads ) {
+        if( tthread.joinable() ) tthread.join();
+    }
+    mThreads.clear();
+    if( mDecodeSys != nullptr ) {
+        FMOD_System_Release(mDecodeSys);
+        mDecodeSys = nullptr;
+    }
+}
+
+//--------------------
+bool ofxMultiSpeakerLoudness::analyze( std::string aFilePath ) {
+    string tpath = ofToDataPath( aFilePath, true );
+    {
+        std::unique_lock<std::mutex> tlock( mMutex );
+        if( mResults.count(tpath) ) return true;
+        if( mPending.count(tpath) ) return false;
+    }
+
+    // a matching size and modified time is enough to trust the cache without hashing //
+    FileStamp tstamp;
+    Result tresult;
+    if( getFileStamp(tpath, tstamp) && readCache(tpath, tstamp, false, tresult) ) {
+        std::unique_lock<std::mutex> tlock( mMutex );
+        mResults[tpath] = tresult;
+        return true;
+    }
+
+    std::unique_lock<std::mutex> tlock( mMutex );
+    if( !mBRunning ) {
+        ofLogError("ofxMultiSpeakerLoudness :: analyze : call setup() before analyzing ") << aFilePath;
+        return false;
+    }
+    mPending.insert( tpath );
+    mQueue.push_back( tpath );
+    tlock.unlock();
+    mCondition.notify_one();
+    return false;
+}
+
+//--------------------
+bool ofxMultiSpeakerLoudness::hasResult( std::string aFilePath ) {
+    std::unique_lock<std::mutex> tlock( mMutex );
+    return mResults.count( ofToDataPath(aFilePath, true) ) > 0;
+}
+
+//--------------------
+bool ofxMultiSpeakerLoudness::getResult( std::string aFilePath, Result& aOutResult ) {
+    std::unique_lock<std::mutex> tlock( mMutex );
+    auto it = mResults.find( ofToDataPath(aFilePath, true) );
+    if( it == mResults.end() ) return false;
+    aOutResult = it->second;
+    return true;
+}
+
+//--------------------
+size_t ofxMultiSpeakerLoudness::getNumPending() {
+    std::unique_lock<std::mutex> tlock( mMutex );
+    return mPending.size();
+}
+
+//--------------------
+float ofxMultiSpeakerLoudness::getNormalizeGain( const Result& aresult, float atargetLUFS, float amaxTruePeakDB ) {
+    if( !aresult.bValid || aresult.integratedLUFS <= -70.0f ) return 1.0f;
+    float tgainDB = atargetLUFS - aresult.integratedLUFS;
+    tgainDB = std::min( tgainDB, amaxTruePeakDB - aresult.truePeakDB );
+    return powf( 10.0f, tgainDB / 20.0f );
+}
+
+//--------------------
+void ofxMultiSpeakerLoudness::workerThread() {
+    while( true ) {
+        string tpath;
+        {
+            std::unique_lock<std::mutex> tlock( mMutex );
+            mCondition.wait( tlock, [this]() { return !mBRunning || !mQueue.empty(); } );
+            if( !mBRunning ) return;
+            tpath = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        Result tresult;
+        FileStamp tstamp;
+        getFileStamp( tpath, tstamp );
+        if( !readCache(tpath, tstamp, true, tresult) ) {
+            if( analyzeFile(tpath, tresult) ) {
+                writeCache( tpath, tstamp, hashFile(tpath), tresult );
+            } else {
+                ofLogError("ofxMultiSpeakerLoudness :: unable to analyze ") << tpath;
+            }
+        }
+
+        std::unique_lock<std::mutex> tlock( mMutex );
+        if( !mBRunning ) return;
+        mResults[tpath] = tresult;
+        mPending.erase( tpath );
+    }
+}
+
+//--------------------
+bool ofxMultiSpeakerLoudness::analyzeFile( const std::string& aFilePath, Result& aOutResult ) {
+    aOutResult = Result();
+    aOutResult.filePath = aFilePath;
+
+    FMOD_SOUND* tsound = nullptr;
+    if( FMOD_System_CreateSound(mDecodeSys, aFilePath.c_str(), FMOD_OPENONLY, NULL, &tsound) != FMOD_OK ) {
+        return false;
+    }
+    FMOD_SOUND_TYPE ttype;
+    FMOD_SOUND_FORMAT tformat;
+    int tnumChannels = 0;
+    int tbits = 0;
+    float tsampleRate = 0;
+    FMOD_Sound_GetFormat(tsound, &ttype, &tformat, &tnumChannels, &tbits);
+    FMOD_Sound_GetDefaults(tsound, &tsampleRate, NULL);
+    if( tnumChannels < 1 || tbits < 8 || tsampleRate < 1.0f ) {
+        FMOD_Sound_Release(tsound);
+        return false;
+    }
+
+    // BS.1770 channel weights, the lfe is skipped and surrounds are boosted //
+    std::vector<double> tweights( tnumChannels, 1.0 );
+    if( tnumChannels == 6 || tnumChannels == 8 ) {
+        tweights[FMOD_SPEAKER_LOW_FREQUENCY] = 0.0;
+        for( int c = FMOD_SPEAKER_SURROUND_LEFT; c < tnumChannels; c++ ) {
+            tweights[c] = 1.41;
+        }
+    }
+
+    std::vector<LoudnessBiquad> tshelves( tnumChannels );
+    std::vector<LoudnessBiquad> thighPasses( tnumChannels );
+    for( int c = 0; c < tnumChannels; c++ ) {
+        setupKWeighting( tshelves[c], thighPasses[c], tsampleRate );
+    }
+
+    const std::vector<float>& tpeakCoeffs = getTruePeakCoefficients();
+    std::vector<float> tpeakHistory( (size_t)tnumChannels * TRUE_PEAK_TAPS, 0.0f );
+    int tpeakPos = 0;
+
+    // mean square of the k weighted signal in 100ms hops, 4 hops make a 400ms gating block //
+    int thopSize = std::max( (int)(tsampleRate * 0.1f + 0.5f), 1 );
+    std::vector<double> thopPowers;
+    double thopSum = 0.0;
+    int thopCount = 0;
+    double tsumSquares = 0.0;
+    double tpeak = 0.0;
+    uint64_t tnumFrames = 0;
+
+    // whole frames per read so channels stay aligned //
+    int tframeBytes = (tbits / 8) * tnumChannels;
+    std::vector<char> tchunk( (size_t)tframeBytes * 4096 );
+    std::vector<float> tsamples( (size_t)tnumChannels * 4096 );
+
+    while( true ) {
+        unsigned int tread = 0;
+        FMOD_RESULT tres = FMOD_Sound_ReadData(tsound, tchunk.data(), (unsigned int)tchunk.size(), &tread);
+        size_t tnum = 0;
+        if( tread > 0 ) {
+            tnum = ofxMultiSpeakerSoundPlayer::convertPCMToFloat( tchunk.data(), tread, tformat, tsamples.data() );
+        }
+        size_t tframes = tnum / tnumChannels;
+        for( size_t f = 0; f < tframes; f++ ) {
+            const float* tframe = &tsamples[f * tnumChannels];
+            for( int c = 0; c < tnumChannels; c++ ) {
+                double x = tframe[c];
+                tsumSquares += x * x;
+
+                double k = thighPasses[c].process( tshelves[c].process(x) );
+                thopSum += tweights[c] * k * k;
+
+                float* thistory = &tpeakHistory[(size_t)c * TRUE_PEAK_TAPS];
+                thistory[tpeakPos] = (float)x;
+                for( int p = 0; p < TRUE_PEAK_PHASES; p++ ) {
+                    const float* tcoeffs = &tpeakCoeffs[p * TRUE_PEAK_TAPS];
+                    float ty = 0.0f;
+                    for( int t = 0; t < TRUE_PEAK_TAPS; t++ ) {
+                        ty += tcoeffs[t] * thistory[(tpeakPos - t + TRUE_PEAK_TAPS) % TRUE_PEAK_TAPS];
+                    }
+                    tpeak = std::max( tpeak, (double)fabsf(ty) );
+                }
+                tpeak = std::max( tpeak, fabs(x) );
+            }
+            tpeakPos = (tpeakPos + 1) % TRUE_PEAK_TAPS;
+
+            thopCount++;
+            if( thopCount >= thopSize ) {
+                thopPowers.push_back( thopSum / (double)thopCount );
+                thopSum = 0.0;
+                thopCount = 0;
+            }
+        }
+        tnumFrames += tframes;
+        if( tres != FMOD_OK || tread == 0 ) break;
+    }
+    FMOD_Sound_Release(tsound);
+
+    if( tnumFrames == 0 ) return false;
+    if( thopCount > 0 && thopPowers.size() < 4 ) {
+        thopPowers.push_back( thopSum / (double)thopCount );
+    }
+
+    std::vector<double> tblockPowers;
+    if( thopPowers.size() < 4 ) {
+        double tsum = 0.0;
+        for( auto tpower : thopPowers ) tsum += tpower;
+        tblockPowers.push_back( tsum / (double)thopPowers.size() );
+    } else {
+        for( size_t i = 3; i < thopPowers.size(); i++ ) {
+            tblockPowers.push_back( (thopPowers[i] + thopPowers[i-1] + thopPowers[i-2] + thopPowers[i-3]) * 0.25 );
+        }
+    }
+
+    // absolute gate at -70 LUFS, then a relative gate 10 LU under the absolute gated loudness //
+    auto toLUFS = []( double apower ) { return apower <= 0.0 ? -200.0 : -0.691 + 10.0 * log10( apower ); };
+    double tsum = 0.0;
+    int tcount = 0;
+    for( auto tpower : tblockPowers ) {
+        if( toLUFS(tpower) > -70.0 ) {
+            tsum += tpower;
+            tcount++;
+        }
+    }
+    double tintegrated = -70.0;
+    if( tcount > 0 ) {
+        double trelativeGate = toLUFS( tsum / (double)tcount ) - 10.0;
+        tsum = 0.0;
+        tcount = 0;
+        for( auto tpower : tblockPowers ) {
+            double tlufs = toLUFS( tpower );
+            if( tlufs > -70.0 && tlufs > trelativeGate ) {
+                tsum += tpower;
+                tcount++;
+            }
+        }
+        if( tcount > 0 ) {
+            tintegrated = std::max( toLUFS( tsum / (double)tcount ), -70.0 );
+        }
+    }
+
+    aOutResult.bValid = true;
+    aOutResult.integratedLUFS = (float)tintegrated;
+    aOutResult.truePeakDB = toDB( tpeak );
+    aOutResult.rmsDB = toDB( sqrt( tsumSquares / (double)(tnumFrames * tnumChannels) ) );
+    aOutResult.durationSeconds = (float)((double)tnumFrames / (double)tsampleRate);
+    return true;
+}
+
+//--------------------
+std::string ofxMultiSpeakerLoudness::getCachePath( const std::string& aFilePath ) {
+    if( mSettings.cacheDirectory == "" ) {
+        return aFilePath + ".loudness";
+    }
+    // flatten the path into a unique file name inside the cache folder //
+    std::filesystem::path tpath( aFilePath );
+    std::stringstream tname;
+    tname << tpath.filename().string() << "." << std::hex << std::hash<std::string>()( aFilePath ) << ".loudness";
+    std::filesystem::path tdir( ofToDataPath(mSettings.cacheDirectory, true) );
+    return (tdir / tname.str()).string();
+}
+
+//--------------------
+bool ofxMultiSpeakerLoudness::readCache( const std::string& aFilePath, const FileStamp& astamp, bool abCheckHash, Result& aOutResult ) {
+    std::ifstream tfile( getCachePath(aFilePath) );
+    if( !tfile.is_open() ) return false;
+
+    std::map<std::string, std::string> tvalues;
+    std::string tline;
+    while( std::getline(tfile, tline) ) {
+        auto tpos = tline.find( '=' );
+        if( tpos == std::string::npos ) continue;
+        tvalues[tline.substr(0, tpos)] = tline.substr(tpos + 1);
+    }
+    tfile.close();
+
+    try {
+        if( std::stoi(tvalues.at("version")) != LOUDNESS_CACHE_VERSION ) return false;
+        uint64_t tsize = std::stoull( tvalues.at("size") );
+        int64_t tmtime = std::stoll( tvalues.at("mtime") );
+        uint64_t thash = std::stoull( tvalues.at("hash"), nullptr, 16 );
+        if( tsize != astamp.size ) return false;
+        if( tmtime != astamp.mtime ) {
+            // the file was touched or copied, only trust the cache if the contents match //
+            if( !abCheckHash || hashFile(aFilePath) != thash ) return false;
+        }
+
+        aOutResult = Result();
+        aOutResult.filePath = aFilePath;
+        aOutResult.integratedLUFS = std::stof( tvalues.at("integratedLUFS") );
+        aOutResult.truePeakDB = std::stof( tvalues.at("truePeakDB") );
+        aOutResult.rmsDB = std::stof( tvalues.at("rmsDB") );
+        aOutResult.durationSeconds = std::stof( tvalues.at("durationSeconds") );
+        aOutResult.bValid = true;
+        aOutResult.bFromCache = true;
+
+        if( tmtime != astamp.mtime ) {
+            writeCache( aFilePath, astamp, thash, aOutResult );
+        }
+    } catch( std::exception& e ) {
+        ofLogWarning("ofxMultiSpeakerLoudness :: readCache : invalid cache for ") << aFilePath << " : " << e.what();
+        return false;
+    }
+    return true;
+}
+
+//--------------------
+bool ofxMultiSpeakerLoudness::writeCache( const std::string& aFilePath, const FileStamp& astamp, uint64_t ahash, const Result& aresult ) {
+    string tcachePath = getCachePath( aFilePath );
+    if( mSettings.cacheDirectory != "" ) {
+        std::error_code terror;
+        std::filesystem::create_directories( std::filesystem::path(tcachePath).parent_path(), terror );
+    }
+    std::ofstream tfile( tcachePath, std::ios::trunc );
+    if( !tfile.is_open() ) {
+        ofLogWarning("ofxMultiSpeakerLoudness :: writeCache : unable to write ") << tcachePath;
+        return false;
+    }
+    tfile << "version=" << LOUDNESS_CACHE_VERSION << "\n";
+    tfile << "size=" << astamp.size << "\n";
+    tfile << "mtime=" << astamp.mtime << "\n";
+    tfile << "hash=" << std::hex << ahash << std::dec << "\n";
+    tfile << "integratedLUFS=" << aresult.integratedLUFS << "\n";
+    tfile << "truePeakDB=" << aresult.truePeakDB << "\n";
+    tfile << "rmsDB=" << aresult.rmsDB << "\n";
+    tfile << "durationSeconds=" << aresult.durationSeconds << "\n";
+    return tfile.good();
+}
+
+//--------------------
+bool ofxMultiSpeakerLoudness::getFileStamp( const std::string& aFilePath, FileStamp& aOutStamp ) {
+    std::error_code terror;
+    aOutStamp.size = (uint64_t)std::filesystem::file_size( aFilePath, terror );
+    if( terror ) return false;
+    auto ttime = std::filesystem::last_write_time( aFilePath, terror );
+    if( terror ) return false;
+    aOutStamp.mtime = (int64_t)ttime.time_since_epoch().count();
+    return true;
+}
+
+// 64 bit fnv-1a of the file contents //
+//--------------------
+uint64_t ofxMultiSpeakerLoudness::hashFile( const std::string& aFilePath ) {
+    std::ifstream tfile( aFilePath, std::ios::binary );
+    uint64_t thash = 14695981039346656037ull;
+    std::vector<char> tbuffer( 1 << 16 );
+    while( tfile ) {
+        tfile.read( tbuffer.data(), tbuffer.size() );
+        std::streamsize tnum = tfile.gcount();
+        for( std::streamsize i = 0; i < tnum; i++ ) {
+            thash ^= (uint8_t)tbuffer[i];
+            thash *= 1099511628211ull;
+        }
+    }
+    return thash;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ofConstants.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+extern "C" {
+#include "fmod.h"
+}
+
+// measures integrated loudness ( ITU-R BS.1770 ), true peak and rms of sound files on worker threads //
+// results are stored in a small sidecar file, keyed by file size, modified time and a hash of the file //
+class ofxMultiSpeakerLoudness {
+public:
+
+    struct Settings {
+        int numThreads = 2;
+        // folder for the cache files, empty = next to each sound file as <file>.loudness //
+        std::string cacheDirectory = "";
+    };
+
+    struct Result {
+        std::string filePath = "";
+        bool bValid = false;
+        bool bFromCache = false;
+        float integratedLUFS = -70.0f;
+        float truePeakDB = -144.0f;
+        float rmsDB = -144.0f;
+        float durationSeconds = 0.0f;
+    };
+
+    ofxMultiSpeakerLoudness();
+    ~ofxMultiSpeakerLoudness();
+
+    bool setup( Settings asettings );
+    bool setup() { return setup( Settings() ); }
+    void close();
+
+    // returns true if the result is already known or could be read from the cache, otherwise queues the file //
+    bool analyze( std::string aFilePath );
+    bool hasResult( std::string aFilePath );
+    bool getResult( std::string aFilePath, Result& aOutResult );
+    size_t getNumPending();
+
+    // linear gain to reach atargetLUFS, limited so the true peak stays under amaxTruePeakDB //
+    static float getNormalizeGain( const Result& aresult, float atargetLUFS, float amaxTruePeakDB = -1.0f );
+
+protected:
+    struct FileStamp {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    void workerThread();
+    bool analyzeFile( const std::string& aFilePath, Result& aOutResult );
+    std::string getCachePath( const std::string& aFilePath );
+    bool readCache( const std::string& aFilePath, const FileStamp& astamp, bool abCheckHash, Result& aOutResult );
+    bool writeCache( const std::string& aFilePath, const FileStamp& astamp, uint64_t ahash, const Result& aresult );
+    static bool getFileStamp( const std::string& aFilePath, FileStamp& aOutStamp );
+    static uint64_t hashFile( const std::string& aFilePath );
+
+    Settings mSettings;
+    // decode only fmod system, so analysis never contends with the playback system //
+    FMOD_SYSTEM* mDecodeSys = nullptr;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::string> mQueue;
+    std::set<std::string> mPending;
+    std::map<std::string, Result> mResults;
+    bool mBRunning = false;
+    std::vector<std::thread> mThreads;
+
+};
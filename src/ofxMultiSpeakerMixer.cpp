@@ -0,0 +1,647 @@
+#include "ofxMultiSpeakerMixer.h"
+#include "ofxMultiSpeakerSoundPlayer.h"
+#include "ofxMultiSpeakerTrace.h"
+#include "ofLog.h"
+#include "ofMath.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define OFX_MULTI_SPEAKER_MIX_AVX2
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OFX_MULTI_SPEAKER_MIX_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OFX_MULTI_SPEAKER_MIX_NEON
+#endif
+
+#if defined(TARGET_LINUX) && !defined(OFX_MULTI_SPEAKER_NO_ALSA)
+#include <alsa/asoundlib.h>
+#define OFX_MULTI_SPEAKER_ALSA
+#endif
+
+// aOut[i] += aIn[i] * ( again + adelta * i ) //
+//--------------------
+static void mixGainRamp( float* aOut, const float* aIn, float again, float adelta, int anum ) {
+    int i = 0;
+#if defined(OFX_MULTI_SPEAKER_MIX_AVX2)
+    __m256 tgain = _mm256_add_ps( _mm256_set1_ps(again), _mm256_mul_ps( _mm256_set1_ps(adelta), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7) ) );
+    __m256 tstep = _mm256_set1_ps( adelta * 8.0f );
+    for( ; i + 8 <= anum; i += 8 ) {
+        _mm256_storeu_ps( aOut + i, _mm256_fmadd_ps( _mm256_loadu_ps(aIn + i), tgain, _mm256_loadu_ps(aOut + i) ) );
+        tgain = _mm256_add_ps( tgain, tstep );
+    }
+#elif defined(OFX_MULTI_SPEAKER_MIX_SSE)
+    __m128 tgain = _mm_add_ps( _mm_set1_ps(again), _mm_mul_ps( _mm_set1_ps(adelta), _mm_setr_ps(0, 1, 2, 3) ) );
+    __m128 tstep = _mm_set1_ps( adelta * 4.0f );
+    for( ; i + 4 <= anum; i += 4 ) {
+        _mm_storeu_ps( aOut + i, _mm_add_ps( _mm_loadu_ps(aOut + i), _mm_mul_ps( _mm_loadu_ps(aIn + i), tgain ) ) );
+        tgain = _mm_add_ps( tgain, tstep );
+    }
+#elif defined(OFX_MULTI_SPEAKER_MIX_NEON)
+    const float tramp[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    float32x4_t tgain = vmlaq_n_f32( vdupq_n_f32(again), vld1q_f32(tramp), adelta );
+    float32x4_t tstep = vdupq_n_f32( adelta * 4.0f );
+    for( ; i + 4 <= anum; i += 4 ) {
+        vst1q_f32( aOut + i, vmlaq_f32( vld1q_f32(aOut + i), vld1q_f32(aIn + i), tgain ) );
+        tgain = vaddq_f32( tgain, tstep );
+    }
+#endif
+    for( ; i < anum; i++ ) {
+        aOut[i] += aIn[i] * ( again + adelta * (float)i );
+    }
+}
+
+// the voice gain rows double as bus channels //
+static_assert( ofxMultiSpeakerMixer::MAX_OUTPUTS >= ofxMultiSpeakerAmbisonics::MAX_CHANNELS, "the gain matrix needs a row per bus channel" );
+
+// the limits are passed by reference to std::min and streams, so they need a definition //
+const int ofxMultiSpeakerMixer::MAX_OUTPUTS;
+const int ofxMultiSpeakerMixer::MAX_CLIP_CHANNELS;
+const uint32_t ofxMultiSpeakerMixer::INVALID_VOICE;
+
+//--------------------
+ofxMultiSpeakerMixer::ofxMultiSpeakerMixer() {
+
+}
+
+//--------------------
+ofxMultiSpeakerMixer::~ofxMultiSpeakerMixer() {
+    close();
+}
+
+//--------------------
+bool ofxMultiSpeakerMixer::setup( Settings asettings ) {
+    close();
+    mSettings = asettings;
+    mSettings.numOutputs = ofClamp( mSettings.numOutputs, 1, MAX_OUTPUTS );
+    mSettings.maxVoices = ofClamp( mSettings.maxVoices, 1, 65535 );
+    mSettings.blockSize = std::max( mSettings.blockSize, 16 );
+    mSettings.numBuffers = std::max( mSettings.numBuffers, 2 );
+    if( mSettings.sampleRate <= 0 ) {
+        ofLogError("ofxMultiSpeakerMixer :: setup : invalid sample rate ") << mSettings.sampleRate;
+        return false;
+    }
+
+    if( FMOD_System_Create(&mDecodeSys) != FMOD_OK ) {
+        ofLogError("ofxMultiSpeakerMixer :: setup : unable to create decode system");
+        mDecodeSys = nullptr;
+        return false;
+    }
+    // no output and no mixer thread, the system is only used to open and decode files //
+    FMOD_System_SetOutput(mDecodeSys, FMOD_OUTPUTTYPE_NOSOUND_NRT);
+    if( FMOD_System_Init(mDecodeSys, 1, FMOD_INIT_NORMAL, NULL) != FMOD_OK ) {
+        ofLogError("ofxMultiSpeakerMixer :: setup : unable to init decode system");
+        FMOD_System_Release(mDecodeSys);
+        mDecodeSys = nullptr;
+        return false;
+    }
+
+    mVoices.reset( new Voice[mSettings.maxVoices] );
+    mFreeVoices.clear();
+    // lowest index on top, so the voices the mixer looks at stay packed at the start //
+    for( int i = mSettings.maxVoices - 1; i >= 0; i-- ) {
+        mFreeVoices.push_back( i );
+    }
+    mNumVoicesInUse = 0;
+    mNumVoiceSlots = 0;
+
+    mOutputs.assign( mSettings.numOutputs, std::vector<float>( mSettings.blockSize, 0.0f ) );
+    mScratch.assign( MAX_CLIP_CHANNELS, std::vector<float>( mSettings.blockSize, 0.0f ) );
+    mDownmix.assign( mSettings.blockSize, 0.0f );
+    mInterleaved.assign( (size_t)mSettings.blockSize * mSettings.numOutputs, 0.0f );
+
+    mBus.clear();
+    mDecoder.clear();
+    if( mSettings.bAmbisonicBus ) {
+        auto& tambisonics = mSettings.ambisonics;
+        tambisonics.order = ofClamp( tambisonics.order, 1, ofxMultiSpeakerAmbisonics::MAX_ORDER );
+        if( tambisonics.speakers.empty() ) {
+            tambisonics.speakers = ofxMultiSpeakerAmbisonics::getDefaultSpeakers( FMOD_SPEAKERMODE_7POINT1POINT4 );
+        }
+        mDecoder = ofxMultiSpeakerAmbisonics::computeDecoder( tambisonics.speakers, tambisonics.order, tambisonics.bMaxRE, mSettings.numOutputs );
+        mBus.assign( ofxMultiSpeakerAmbisonics::getNumChannels(tambisonics.order), std::vector<float>( mSettings.blockSize, 0.0f ) );
+        ofLogNotice("ofxMultiSpeakerMixer :: setup : order ") << tambisonics.order << " ambisonic bus with " << mBus.size() << " channels";
+    }
+
+    mClock = 0;
+    mBlocksMixed = 0;
+    mActiveVoices = 0;
+    mLastMixMicros = 0.0f;
+    mMaxMixMicros = 0.0f;
+    mTotalMixMicros = 0.0;
+    mUnderruns = 0;
+
+    if( mSettings.outputType == OUTPUT_ALSA && !openAlsa() ) {
+        close();
+        return false;
+    }
+
+    if( mSettings.bStartThread ) {
+        mBRunning = true;
+        mThread = std::thread( &ofxMultiSpeakerMixer::threadLoop, this );
+    }
+    ofLogNotice("ofxMultiSpeakerMixer :: setup : ") << mSettings.numOutputs << " outputs at " << mSettings.sampleRate << " Hz, " << mSettings.maxVoices << " voices, " << getKernelName() << " kernel";
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixer::close() {
+    mBRunning = false;
+    if( mThread.joinable() ) {
+        mThread.join();
+    }
+    closeAlsa();
+    mVoices.reset();
+    mFreeVoices.clear();
+    mRetired.clear();
+    mNumVoicesInUse = 0;
+    mNumVoiceSlots = 0;
+    if( mDecodeSys != nullptr ) {
+        FMOD_System_Release(mDecodeSys);
+        mDecodeSys = nullptr;
+    }
+}
+
+//--------------------
+std::shared_ptr<ofxMultiSpeakerMixer::Clip> ofxMultiSpeakerMixer::loadClip( std::string aFilePath ) {
+    if( mDecodeSys == nullptr ) {
+        ofLogError("ofxMultiSpeakerMixer :: loadClip : call setup() first");
+        return nullptr;
+    }
+    std::vector<float> tsamples;
+    int tnumChannels = 0;
+    float tsampleRate = 0;
+    if( !ofxMultiSpeakerSoundPlayer::loadPCMFloat( aFilePath, tsamples, tnumChannels, tsampleRate, mDecodeSys ) ) {
+        ofLogError("ofxMultiSpeakerMixer :: loadClip : unable to decode ") << aFilePath;
+        return nullptr;
+    }
+    return createClip( tsamples, tnumChannels, tsampleRate );
+}
+
+//--------------------
+std::shared_ptr<ofxMultiSpeakerMixer::Clip> ofxMultiSpeakerMixer::createClip( const std::vector<float>& aInterleaved, int anumChannels, float asampleRate ) {
+    if( anumChannels < 1 || anumChannels > MAX_CLIP_CHANNELS ) {
+        ofLogError("ofxMultiSpeakerMixer :: createClip : clips can have 1 to ") << MAX_CLIP_CHANNELS << " channels, not " << anumChannels;
+        return nullptr;
+    }
+    auto tclip = std::make_shared<Clip>();
+    tclip->numChannels = anumChannels;
+    tclip->sampleRate = asampleRate;
+    tclip->numFrames = aInterleaved.size() / anumChannels;
+    tclip->channels.assign( anumChannels, std::vector<float>( tclip->numFrames ) );
+    for( size_t i = 0; i < tclip->numFrames; i++ ) {
+        for( int c = 0; c < anumChannels; c++ ) {
+            tclip->channels[c][i] = aInterleaved[i * anumChannels + c];
+        }
+    }
+    return tclip;
+}
+
+//--------------------
+uint32_t ofxMultiSpeakerMixer::startVoice( std::shared_ptr<const Clip> aclip, const VoiceParams& aparams ) {
+    if( !isSetup() || !aclip || aclip->numChannels < 1 || aclip->numChannels > MAX_CLIP_CHANNELS ) {
+        return INVALID_VOICE;
+    }
+    if( mFreeVoices.empty() ) {
+        ofLogWarning("ofxMultiSpeakerMixer :: startVoice : all ") << mSettings.maxVoices << " voices are in use";
+        return INVALID_VOICE;
+    }
+    int tindex = mFreeVoices.back();
+    mFreeVoices.pop_back();
+
+    Voice& tvoice = mVoices[tindex];
+    tvoice.bInUse = true;
+    tvoice.generation++;
+    tvoice.clip = aclip;
+    tvoice.command.params = aparams;
+    tvoice.command.clip = aclip.get();
+    tvoice.command.startCounter++;
+    tvoice.command.seekFrame = 0.0;
+    tvoice.publishedPosition = 0.0;
+    publish( tvoice );
+
+    if( tindex >= mNumVoiceSlots.load(std::memory_order_relaxed) ) {
+        mNumVoiceSlots.store( tindex + 1, std::memory_order_release );
+    }
+    mNumVoicesInUse++;
+    return (uint32_t)tindex | ((uint32_t)tvoice.generation << 16);
+}
+
+//--------------------
+bool ofxMultiSpeakerMixer::setVoiceParams( uint32_t avoice, const VoiceParams& aparams ) {
+    Voice* tvoice = getVoice( avoice );
+    if( tvoice == nullptr ) return false;
+    tvoice->command.params = aparams;
+    publish( *tvoice );
+    return true;
+}
+
+//--------------------
+bool ofxMultiSpeakerMixer::setVoicePosition( uint32_t avoice, double aframe ) {
+    Voice* tvoice = getVoice( avoice );
+    if( tvoice == nullptr ) return false;
+    tvoice->command.seekCounter++;
+    tvoice->command.seekFrame = std::max( aframe, 0.0 );
+    tvoice->publishedPosition = tvoice->command.seekFrame;
+    publish( *tvoice );
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixer::stopVoice( uint32_t avoice ) {
+    Voice* tvoice = getVoice( avoice );
+    if( tvoice == nullptr ) return;
+    // the mixer fades the voice out over its next block, then lets go of the clip //
+    tvoice->command.clip = nullptr;
+    publish( *tvoice );
+    releaseVoice( avoice & 0xFFFF );
+}
+
+//--------------------
+bool ofxMultiSpeakerMixer::isVoicePlaying( uint32_t avoice ) const {
+    Voice* tvoice = getVoice( avoice );
+    if( tvoice == nullptr ) return false;
+    return tvoice->finishedCounter.load(std::memory_order_acquire) != tvoice->command.startCounter;
+}
+
+//--------------------
+double ofxMultiSpeakerMixer::getVoicePosition( uint32_t avoice ) const {
+    Voice* tvoice = getVoice( avoice );
+    if( tvoice == nullptr ) return 0.0;
+    return tvoice->publishedPosition.load();
+}
+
+//--------------------
+void ofxMultiSpeakerMixer::update() {
+    if( !isSetup() ) return;
+    int tnumSlots = mNumVoiceSlots.load(std::memory_order_relaxed);
+    for( int i = 0; i < tnumSlots; i++ ) {
+        Voice& tvoice = mVoices[i];
+        if( tvoice.bInUse && tvoice.finishedCounter.load(std::memory_order_acquire) == tvoice.command.startCounter ) {
+            releaseVoice( i );
+        }
+    }
+    uint64_t tblocks = mBlocksMixed.load();
+    mRetired.erase( std::remove_if( mRetired.begin(), mRetired.end(), [tblocks]( const RetiredClip& aretired ) {
+        return aretired.freeAtBlock <= tblocks;
+    }), mRetired.end() );
+}
+
+//--------------------
+ofxMultiSpeakerMixer::Voice* ofxMultiSpeakerMixer::getVoice( uint32_t avoice ) const {
+    if( !isSetup() || avoice == INVALID_VOICE ) return nullptr;
+    int tindex = avoice & 0xFFFF;
+    if( tindex >= mSettings.maxVoices ) return nullptr;
+    Voice& tvoice = mVoices[tindex];
+    if( !tvoice.bInUse || tvoice.generation != (uint16_t)(avoice >> 16) ) return nullptr;
+    return &tvoice;
+}
+
+//--------------------
+void ofxMultiSpeakerMixer::publish( Voice& avoice ) {
+    avoice.slots[avoice.back] = avoice.command;
+    avoice.back = avoice.middle.exchange( avoice.back | DIRTY, std::memory_order_acq_rel ) & 3;
+}
+
+//--------------------
+void ofxMultiSpeakerMixer::releaseVoice( int aindex ) {
+    Voice& tvoice = mVoices[aindex];
+    if( !tvoice.bInUse ) return;
+    // the block being mixed and the next one may still read the clip //
+    mRetired.push_back( { tvoice.clip, mBlocksMixed.load() + 2 } );
+    tvoice.clip.reset();
+    tvoice.bInUse = false;
+    mFreeVoices.push_back( aindex );
+    mNumVoicesInUse--;
+}
+
+//--------------------
+bool ofxMultiSpeakerMixer::advance( Voice& avoice, double arate, int anumFrames ) {
+    double tnumFrames = (double)avoice.mixClip->numFrames;
+    avoice.position += arate * anumFrames;
+    const Command& tcommand = avoice.slots[avoice.front];
+    if( tcommand.params.bLoop ) {
+        avoice.position = fmod( avoice.position, tnumFrames );
+        if( avoice.position < 0.0 ) avoice.position += tnumFrames;
+        return true;
+    }
+    return avoice.position >= 0.0 && avoice.position < tnumFrames;
+}
+
+//--------------------
+bool ofxMultiSpeakerMixer::isSpread( const float* acurrent, const float* atargets, int anumOutputs, int anumChannels ) {
+    for( int o = 0; o < anumOutputs; o++ ) {
+        const float* tcurrent = acurrent + o * MAX_CLIP_CHANNELS;
+        const float* ttarget = atargets + o * MAX_CLIP_CHANNELS;
+        for( int c = 1; c < anumChannels; c++ ) {
+            if( tcurrent[c] != tcurrent[0] || ttarget[c] != ttarget[0] ) return false;
+        }
+    }
+    return true;
+}
+
+//--------------------
+bool ofxMultiSpeakerMixer::mixVoice( Voice& avoice ) {
+    if( avoice.middle.load(std::memory_order_acquire) & DIRTY ) {
+        avoice.front = avoice.middle.exchange( avoice.front, std::memory_order_acq_rel ) & 3;
+        const Command& tcommand = avoice.slots[avoice.front];
+        if( tcommand.startCounter != avoice.mixStartCounter ) {
+            avoice.mixStartCounter = tcommand.startCounter;
+            avoice.mixSeekCounter = tcommand.seekCounter;
+            avoice.mixClip = tcommand.clip;
+            avoice.position = tcommand.seekFrame;
+            avoice.bSnapGains = true;
+        } else if( tcommand.seekCounter != avoice.mixSeekCounter ) {
+            avoice.mixSeekCounter = tcommand.seekCounter;
+            avoice.position = tcommand.seekFrame;
+        }
+    }
+
+    const Clip* tclip = avoice.mixClip;
+    if( tclip == nullptr ) return false;
+    const Command& tcommand = avoice.slots[avoice.front];
+    const VoiceParams& tparams = tcommand.params;
+    bool bStopping = tcommand.clip == nullptr;
+
+    if( tparams.bPaused ) {
+        if( bStopping ) avoice.mixClip = nullptr;
+        return !bStopping;
+    }
+
+    uint64_t tclock = mClock.load(std::memory_order_relaxed);
+    int tblockSize = mSettings.blockSize;
+    int toffset = 0;
+    if( tparams.startClock > tclock ) {
+        if( bStopping ) {
+            avoice.mixClip = nullptr;
+            return false;
+        }
+        // scheduled for a later block //
+        if( tparams.startClock >= tclock + tblockSize ) return true;
+        toffset = (int)( tparams.startClock - tclock );
+    }
+    int tframes = tblockSize - toffset;
+    int tnumChannels = tclip->numChannels;
+
+    // ambisonic voices mix into the bus, switching changes what the gains mean so there is nothing to ramp from //
+    bool bAmbisonic = tparams.bAmbisonic && !mBus.empty();
+    if( bAmbisonic != avoice.bMixAmbisonic ) {
+        avoice.bMixAmbisonic = bAmbisonic;
+        avoice.bSnapGains = true;
+    }
+    std::vector<std::vector<float>>& tdestinations = bAmbisonic ? mBus : mOutputs;
+    int tnumOutputs = (int)tdestinations.size();
+
+    float ttargets[MAX_OUTPUTS * MAX_CLIP_CHANNELS];
+    bool bSilent = true;
+    for( int o = 0; o < tnumOutputs; o++ ) {
+        for( int c = 0; c < tnumChannels; c++ ) {
+            int tindex = o * MAX_CLIP_CHANNELS + c;
+            ttargets[tindex] = bStopping ? 0.0f : tparams.gains[tindex] * tparams.volume;
+            // a new voice starts at its gains, it has nothing to ramp from //
+            if( avoice.bSnapGains ) avoice.currentGains[tindex] = ttargets[tindex];
+            if( ttargets[tindex] != 0.0f || avoice.currentGains[tindex] != 0.0f ) bSilent = false;
+        }
+    }
+
+    avoice.bSnapGains = false;
+
+    double trate = (double)tclip->sampleRate / (double)mSettings.sampleRate * (double)tparams.speed;
+    bool bActive = true;
+    if( bSilent ) {
+        // nothing to hear, only keep time //
+        bActive = advance( avoice, trate, tframes );
+    } else {
+        const float* tsources[MAX_CLIP_CHANNELS];
+        size_t tnumFrames = tclip->numFrames;
+        double tpos = avoice.position;
+        if( trate == 1.0 && tpos >= 0.0 && tpos == floor(tpos) && (size_t)tpos + tframes <= tnumFrames ) {
+            // no resampling, mix straight from the clip //
+            for( int c = 0; c < tnumChannels; c++ ) {
+                tsources[c] = tclip->channels[c].data() + (size_t)tpos;
+            }
+            bActive = advance( avoice, trate, tframes );
+        } else {
+            // linear interpolation, wrapping at the ends when looping //
+            int tvalid = tframes;
+            for( int i = 0; i < tframes; i++ ) {
+                if( tpos >= (double)tnumFrames || tpos < 0.0 ) {
+                    if( !tparams.bLoop || tnumFrames == 0 ) {
+                        tvalid = i;
+                        bActive = false;
+                        break;
+                    }
+                    tpos = fmod( tpos, (double)tnumFrames );
+                    if( tpos < 0.0 ) tpos += (double)tnumFrames;
+                }
+                size_t ti0 = (size_t)tpos;
+                size_t ti1 = ti0 + 1;
+                if( ti1 >= tnumFrames ) ti1 = tparams.bLoop ? 0 : ti0;
+                float tfrac = (float)( tpos - (double)ti0 );
+                for( int c = 0; c < tnumChannels; c++ ) {
+                    const float* tsrc = tclip->channels[c].data();
+                    mScratch[c][i] = tsrc[ti0] + ( tsrc[ti1] - tsrc[ti0] ) * tfrac;
+                }
+                tpos += trate;
+            }
+            for( int c = 0; c < tnumChannels; c++ ) {
+                std::fill( mScratch[c].begin() + tvalid, mScratch[c].begin() + tframes, 0.0f );
+                tsources[c] = mScratch[c].data();
+            }
+            avoice.position = tpos;
+        }
+
+        // when every clip channel has the same gains, sum the channels once and mix that to the outputs //
+        int tnumMixChannels = tnumChannels;
+        if( tnumChannels > 1 && isSpread( avoice.currentGains, ttargets, tnumOutputs, tnumChannels ) ) {
+            float* tdownmix = mDownmix.data();
+            std::copy( tsources[0], tsources[0] + tframes, tdownmix );
+            for( int c = 1; c < tnumChannels; c++ ) {
+                mixGainRamp( tdownmix, tsources[c], 1.0f, 0.0f, tframes );
+            }
+            tsources[0] = tdownmix;
+            tnumMixChannels = 1;
+        }
+
+        // gains ramp from the last block's values to the new ones, so parameter changes do not click //
+        float tinvFrames = 1.0f / (float)tframes;
+        for( int o = 0; o < tnumOutputs; o++ ) {
+            float* tout = tdestinations[o].data() + toffset;
+            for( int c = 0; c < tnumMixChannels; c++ ) {
+                int tindex = o * MAX_CLIP_CHANNELS + c;
+                float tfrom = avoice.currentGains[tindex];
+                float tto = ttargets[tindex];
+                if( tfrom == 0.0f && tto == 0.0f ) continue;
+                mixGainRamp( tout, tsources[c], tfrom, ( tto - tfrom ) * tinvFrames, tframes );
+            }
+            for( int c = 0; c < tnumChannels; c++ ) {
+                avoice.currentGains[o * MAX_CLIP_CHANNELS + c] = ttargets[o * MAX_CLIP_CHANNELS + c];
+            }
+        }
+    }
+
+    avoice.publishedPosition.store( avoice.position, std::memory_order_relaxed );
+    if( !bActive || bStopping ) {
+        avoice.mixClip = nullptr;
+        avoice.finishedCounter.store( avoice.mixStartCounter, std::memory_order_release );
+    }
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixer::mixBlock( float* aOut ) {
+    if( !isSetup() ) return;
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerMixer::mixBlock" );
+    auto tstart = std::chrono::steady_clock::now();
+
+    int tblockSize = mSettings.blockSize;
+    int tnumOutputs = mSettings.numOutputs;
+    for( auto& toutput : mOutputs ) {
+        std::fill( toutput.begin(), toutput.end(), 0.0f );
+    }
+    for( auto& tchannel : mBus ) {
+        std::fill( tchannel.begin(), tchannel.end(), 0.0f );
+    }
+
+    int tnumActive = 0;
+    int tnumSlots = mNumVoiceSlots.load(std::memory_order_acquire);
+    for( int i = 0; i < tnumSlots; i++ ) {
+        if( mixVoice( mVoices[i] ) ) tnumActive++;
+    }
+
+    // the only speaker dependent work for ambisonic voices, once per block however many there are //
+    int tnumBusChannels = (int)mBus.size();
+    for( int o = 0; o < tnumOutputs && tnumBusChannels > 0; o++ ) {
+        float* tout = mOutputs[o].data();
+        for( int k = 0; k < tnumBusChannels; k++ ) {
+            float tgain = mDecoder[o * ofxMultiSpeakerAmbisonics::MAX_CHANNELS + k];
+            if( tgain != 0.0f ) mixGainRamp( tout, mBus[k].data(), tgain, 0.0f, tblockSize );
+        }
+    }
+
+    for( int o = 0; o < tnumOutputs; o++ ) {
+        const float* tsrc = mOutputs[o].data();
+        for( int i = 0; i < tblockSize; i++ ) {
+            aOut[i * tnumOutputs + o] = tsrc[i];
+        }
+    }
+
+    mClock.fetch_add( tblockSize );
+    mBlocksMixed.fetch_add( 1 );
+
+    float tmicros = std::chrono::duration<float, std::micro>( std::chrono::steady_clock::now() - tstart ).count();
+    mActiveVoices = tnumActive;
+    mLastMixMicros = tmicros;
+    if( tmicros > mMaxMixMicros.load() ) mMaxMixMicros = tmicros;
+    mTotalMixMicros = mTotalMixMicros.load() + tmicros;
+}
+
+//--------------------
+ofxMultiSpeakerMixer::Stats ofxMultiSpeakerMixer::getStats() const {
+    Stats tstats;
+    tstats.numBlocks = mBlocksMixed.load();
+    tstats.numActiveVoices = mActiveVoices.load();
+    tstats.lastMixMicros = mLastMixMicros.load();
+    tstats.maxMixMicros = mMaxMixMicros.load();
+    if( tstats.numBlocks > 0 ) {
+        tstats.averageMixMicros = (float)( mTotalMixMicros.load() / (double)tstats.numBlocks );
+    }
+    tstats.numUnderruns = mUnderruns.load();
+    return tstats;
+}
+
+//--------------------
+std::string ofxMultiSpeakerMixer::getKernelName() {
+#if defined(OFX_MULTI_SPEAKER_MIX_AVX2)
+    return "avx2";
+#elif defined(OFX_MULTI_SPEAKER_MIX_SSE)
+    return "sse";
+#elif defined(OFX_MULTI_SPEAKER_MIX_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+//--------------------
+void ofxMultiSpeakerMixer::threadLoop() {
+#ifdef OFX_MULTI_SPEAKER_TRACE
+    ofxMultiSpeakerTrace::setThreadName( "software mixer" );
+#endif
+    auto tblockDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( (double)mSettings.blockSize / (double)mSettings.sampleRate ) );
+    auto tnext = std::chrono::steady_clock::now();
+    while( mBRunning ) {
+        mixBlock( mInterleaved.data() );
+        if( mPcm != nullptr ) {
+            if( !writeAlsa( mInterleaved.data(), mSettings.blockSize ) ) {
+                // the device is gone, keep time so voices still finish //
+                std::this_thread::sleep_for( tblockDuration );
+            }
+        } else if( mSettings.bNullRealtime ) {
+            tnext += tblockDuration;
+            std::this_thread::sleep_until( tnext );
+        }
+    }
+}
+
+//--------------------
+bool ofxMultiSpeakerMixer::openAlsa() {
+#ifdef OFX_MULTI_SPEAKER_ALSA
+    snd_pcm_t* tpcm = nullptr;
+    int terr = snd_pcm_open( &tpcm, mSettings.device.c_str(), SND_PCM_STREAM_PLAYBACK, 0 );
+    if( terr < 0 ) {
+        ofLogError("ofxMultiSpeakerMixer :: openAlsa : unable to open ") << mSettings.device << " : " << snd_strerror(terr);
+        return false;
+    }
+    unsigned int tlatencyMicros = (unsigned int)( 1000000.0 * mSettings.blockSize * mSettings.numBuffers / mSettings.sampleRate );
+    terr = snd_pcm_set_params( tpcm, SND_PCM_FORMAT_FLOAT, SND_PCM_ACCESS_RW_INTERLEAVED, mSettings.numOutputs, mSettings.sampleRate, 1, tlatencyMicros );
+    if( terr < 0 ) {
+        ofLogError("ofxMultiSpeakerMixer :: openAlsa : unable to configure ") << mSettings.device << " : " << snd_strerror(terr);
+        snd_pcm_close( tpcm );
+        return false;
+    }
+    mPcm = tpcm;
+    return true;
+#else
+    ofLogError("ofxMultiSpeakerMixer :: openAlsa : alsa output is not available on this platform");
+    return false;
+#endif
+}
+
+//--------------------
+void ofxMultiSpeakerMixer::closeAlsa() {
+#ifdef OFX_MULTI_SPEAKER_ALSA
+    if( mPcm != nullptr ) {
+        snd_pcm_drain( (snd_pcm_t*)mPcm );
+        snd_pcm_close( (snd_pcm_t*)mPcm );
+    }
+#endif
+    mPcm = nullptr;
+}
+
+//--------------------
+bool ofxMultiSpeakerMixer::writeAlsa( const float* aInterleaved, int anumFrames ) {
+#ifdef OFX_MULTI_SPEAKER_ALSA
+    snd_pcm_t* tpcm = (snd_pcm_t*)mPcm;
+    const float* tdata = aInterleaved;
+    int tleft = anumFrames;
+    while( tleft > 0 && mBRunning ) {
+        snd_pcm_sframes_t twritten = snd_pcm_writei( tpcm, tdata, tleft );
+        if( twritten < 0 ) {
+            if( twritten == -EPIPE ) mUnderruns++;
+            if( snd_pcm_recover( tpcm, (int)twritten, 1 ) < 0 ) return false;
+            continue;
+        }
+        tdata += twritten * mSettings.numOutputs;
+        tleft -= (int)twritten;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "ofConstants.h"
+#include "ofxMultiSpeakerAmbisonics.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+extern "C" {
+#include "fmod.h"
+}
+
+// in process software mixer, an alternative backend to fmod for large numbers of voices //
+// clips are decoded to float with one buffer per channel and mixed to the outputs through a gain matrix //
+// voice parameters reach the mixer thread through a lock free triple buffer per voice, so setting them never waits //
+// build with -mavx2 -mfma to use the avx2 kernel, otherwise sse or neon is used //
+class ofxMultiSpeakerMixer {
+public:
+
+    enum OutputType {
+        // mixes and throws the blocks away, for benchmarking or when the output is recorded //
+        OUTPUT_NULL = 0,
+        OUTPUT_ALSA
+    };
+
+    static const int MAX_OUTPUTS = 16;
+    static const int MAX_CLIP_CHANNELS = 8;
+    static const uint32_t INVALID_VOICE = 0xFFFFFFFF;
+
+    struct Settings {
+        OutputType outputType = OUTPUT_NULL;
+        // alsa pcm name //
+        std::string device = "default";
+        // outputs are in FMOD_SPEAKER order //
+        int numOutputs = 8;
+        int sampleRate = 48000;
+        // frames per mix block //
+        int blockSize = 256;
+        // alsa buffer size in blocks //
+        int numBuffers = 4;
+        // at most 65535 //
+        int maxVoices = 1024;
+        // the null output waits for each block's real time, false mixes as fast as possible //
+        bool bNullRealtime = true;
+        // false = no mixer thread, call mixBlock() yourself, ie. to benchmark the kernel //
+        bool bStartThread = true;
+        // b-format bus for voices with bAmbisonic, decoded to the outputs once per block //
+        bool bAmbisonicBus = false;
+        // no speakers = the FMOD_SPEAKERMODE_7POINT1POINT4 layout, limited to numOutputs //
+        ofxMultiSpeakerAmbisonics::Settings ambisonics;
+    };
+
+    // decoded sound, one contiguous buffer per channel //
+    struct Clip {
+        int numChannels = 0;
+        float sampleRate = 0;
+        size_t numFrames = 0;
+        std::vector<std::vector<float>> channels;
+    };
+
+    struct VoiceParams {
+        // gain from each clip channel to each output, gains[ output * MAX_CLIP_CHANNELS + clipChannel ] //
+        // with bAmbisonic the rows are the acn channels of the bus instead of the outputs //
+        float gains[MAX_OUTPUTS * MAX_CLIP_CHANNELS] = {};
+        bool bAmbisonic = false;
+        // scales all gains, a voice at 0 is not mixed, only its position moves //
+        float volume = 1.0f;
+        // playback rate, negative plays backwards //
+        float speed = 1.0f;
+        bool bLoop = false;
+        bool bPaused = false;
+        // mixer clock of the first frame, 0 = the next block //
+        uint64_t startClock = 0;
+    };
+
+    struct Stats {
+        uint64_t numBlocks = 0;
+        int numActiveVoices = 0;
+        // time spent in mixBlock //
+        float lastMixMicros = 0.0f;
+        float maxMixMicros = 0.0f;
+        float averageMixMicros = 0.0f;
+        uint64_t numUnderruns = 0;
+    };
+
+    ofxMultiSpeakerMixer();
+    ~ofxMultiSpeakerMixer();
+
+    bool setup( Settings asettings );
+    bool setup() { return setup( Settings() ); }
+    void close();
+    bool isSetup() const { return mVoices != nullptr; }
+    const Settings& getSettings() const { return mSettings; }
+    // 0 = no ambisonic bus //
+    int getAmbisonicOrder() const { return mBus.empty() ? 0 : mSettings.ambisonics.order; }
+
+    // decodes the whole file with a decode only fmod system //
+    std::shared_ptr<Clip> loadClip( std::string aFilePath );
+    static std::shared_ptr<Clip> createClip( const std::vector<float>& aInterleaved, int anumChannels, float asampleRate );
+
+    // returns a handle for the other voice calls, INVALID_VOICE if every voice is in use //
+    uint32_t startVoice( std::shared_ptr<const Clip> aclip, const VoiceParams& aparams );
+    bool setVoiceParams( uint32_t avoice, const VoiceParams& aparams );
+    bool setVoicePosition( uint32_t avoice, double aframe );
+    void stopVoice( uint32_t avoice );
+    // true from startVoice until the voice is stopped or a non looping clip reaches its end //
+    bool isVoicePlaying( uint32_t avoice ) const;
+    // frame in the clip, as of the last mixed block //
+    double getVoicePosition( uint32_t avoice ) const;
+    int getNumVoicesInUse() const { return mNumVoicesInUse; }
+
+    // sample clock of the first frame of the next block //
+    uint64_t getClock() const { return mClock.load(); }
+
+    // reclaims finished voices and frees clips the mixer can no longer read, call from the main thread //
+    void update();
+
+    // mixes settings.blockSize frames of interleaved output into aOut //
+    void mixBlock( float* aOut );
+
+    Stats getStats() const;
+    static std::string getKernelName();
+
+protected:
+    struct Command {
+        VoiceParams params;
+        const Clip* clip = nullptr;
+        // a new value restarts the voice //
+        uint32_t startCounter = 0;
+        uint32_t seekCounter = 0;
+        double seekFrame = 0.0;
+    };
+
+    struct Voice {
+        // only touched on the main thread //
+        Command command;
+        std::shared_ptr<const Clip> clip;
+        uint16_t generation = 0;
+        bool bInUse = false;
+        int back = 0;
+        // triple buffer, middle holds a slot index plus the DIRTY bit //
+        Command slots[3];
+        std::atomic<int> middle{1};
+        // only touched on the mixer thread //
+        int front = 2;
+        const Clip* mixClip = nullptr;
+        uint32_t mixStartCounter = 0;
+        uint32_t mixSeekCounter = 0;
+        double position = 0.0;
+        bool bSnapGains = false;
+        bool bMixAmbisonic = false;
+        float currentGains[MAX_OUTPUTS * MAX_CLIP_CHANNELS] = {};
+        // written by the mixer thread //
+        std::atomic<uint32_t> finishedCounter{0};
+        std::atomic<double> publishedPosition{0.0};
+    };
+
+    struct RetiredClip {
+        std::shared_ptr<const Clip> clip;
+        uint64_t freeAtBlock = 0;
+    };
+
+    static const int DIRTY = 4;
+
+    Voice* getVoice( uint32_t avoice ) const;
+    void publish( Voice& avoice );
+    void releaseVoice( int aindex );
+    bool mixVoice( Voice& avoice );
+    bool advance( Voice& avoice, double arate, int anumFrames );
+    static bool isSpread( const float* acurrent, const float* atargets, int anumOutputs, int anumChannels );
+    void threadLoop();
+    bool openAlsa();
+    void closeAlsa();
+    bool writeAlsa( const float* aInterleaved, int anumFrames );
+
+    Settings mSettings;
+    FMOD_SYSTEM* mDecodeSys = nullptr;
+
+    std::unique_ptr<Voice[]> mVoices;
+    std::vector<int> mFreeVoices;
+    std::vector<RetiredClip> mRetired;
+    int mNumVoicesInUse = 0;
+    // voices with a higher index have never been used, so the mixer does not look at them //
+    std::atomic<int> mNumVoiceSlots{0};
+
+    // mixer thread scratch, one buffer per output and per clip channel //
+    std::vector<std::vector<float>> mOutputs;
+    std::vector<std::vector<float>> mScratch;
+    std::vector<float> mDownmix;
+    std::vector<float> mInterleaved;
+    // one buffer per acn channel and the decoder, gains[ output * ofxMultiSpeakerAmbisonics::MAX_CHANNELS + acn ] //
+    std::vector<std::vector<float>> mBus;
+    std::vector<float> mDecoder;
+
+    std::atomic<uint64_t> mClock{0};
+    std::atomic<uint64_t> mBlocksMixed{0};
+    std::atomic<int> mActiveVoices{0};
+    std::atomic<float> mLastMixMicros{0.0f};
+    std::atomic<float> mMaxMixMicros{0.0f};
+    std::atomic<double> mTotalMixMicros{0.0};
+    std::atomic<uint64_t> mUnderruns{0};
+
+    std::atomic<bool> mBRunning{false};
+    std::thread mThread;
+    // snd_pcm_t, kept opaque so alsa is only included in the cpp //
+    void* mPcm = nullptr;
+
+};
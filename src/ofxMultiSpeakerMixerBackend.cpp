@@ -0,0 +1,221 @@
+#include "ofxMultiSpeakerMixerBackend.h"
+#include <algorithm>
+#include <cmath>
+
+//--------------------
+ofxMultiSpeakerMixerBackend::~ofxMultiSpeakerMixerBackend() {
+    unload();
+}
+
+//--------------------
+bool ofxMultiSpeakerMixerBackend::load( std::string apath, bool ) {
+    unload();
+    if( mMixer == nullptr ) return false;
+    // the software mixer decodes the whole file up front, so there is no streaming //
+    mClip = mMixer->loadClip( apath );
+    return mClip != nullptr;
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::unload() {
+    stop();
+    // the mixer holds on to the clip until it can no longer be read //
+    mClip.reset();
+}
+
+//--------------------
+unsigned int ofxMultiSpeakerMixerBackend::getLength() const {
+    return mClip ? (unsigned int)mClip->numFrames : 0;
+}
+
+//--------------------
+int ofxMultiSpeakerMixerBackend::getNumChannels() const {
+    return mClip ? mClip->numChannels : 1;
+}
+
+//--------------------
+bool ofxMultiSpeakerMixerBackend::open( bool abStopPrevious, bool abAmbisonic ) {
+    if( !mClip ) return false;
+    if( abStopPrevious ) {
+        mMixer->stopVoice( mVoice );
+    }
+    mVoice = ofxMultiSpeakerMixer::INVALID_VOICE;
+    // the whole voice is described up front, the mixer picks it up on its next block //
+    mParams = ofxMultiSpeakerMixer::VoiceParams();
+    mParams.bPaused = true;
+    mParams.bAmbisonic = abAmbisonic;
+    mBPending = true;
+    mBDirty = false;
+    return true;
+}
+
+//--------------------
+bool ofxMultiSpeakerMixerBackend::commit() {
+    if( mBPending ) {
+        mBPending = false;
+        mBDirty = false;
+        mVoice = mMixer->startVoice( mClip, mParams );
+        return mVoice != ofxMultiSpeakerMixer::INVALID_VOICE;
+    }
+    if( mBDirty && mVoice != ofxMultiSpeakerMixer::INVALID_VOICE ) {
+        mMixer->setVoiceParams( mVoice, mParams );
+    }
+    mBDirty = false;
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::stop() {
+    if( mMixer != nullptr ) {
+        mMixer->stopVoice( mVoice );
+    }
+    mVoice = ofxMultiSpeakerMixer::INVALID_VOICE;
+    mBPending = false;
+    mBDirty = false;
+}
+
+//--------------------
+bool ofxMultiSpeakerMixerBackend::isPlaying() const {
+    return mMixer != nullptr && mMixer->isVoicePlaying( mVoice );
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setPaused( bool ab ) {
+    mParams.bPaused = ab;
+    mBDirty = true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setVolume( float again ) {
+    mParams.volume = again;
+    mBDirty = true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setSpeed( float aspeed ) {
+    mParams.speed = aspeed;
+    mBDirty = true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setLoop( bool ab ) {
+    mParams.bLoop = ab;
+    mBDirty = true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setPosition( unsigned int aframe ) {
+    mMixer->setVoicePosition( mVoice, aframe );
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setPositionMS( int ams ) {
+    mMixer->setVoicePosition( mVoice, (double)ams * mClip->sampleRate / 1000.0 );
+}
+
+//--------------------
+unsigned int ofxMultiSpeakerMixerBackend::getPosition() const {
+    return (unsigned int)mMixer->getVoicePosition( mVoice );
+}
+
+//--------------------
+int ofxMultiSpeakerMixerBackend::getPositionMS() const {
+    return (int)( mMixer->getVoicePosition( mVoice ) * 1000.0 / mClip->sampleRate );
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setStereoPan( float apan ) {
+    // gains[ output * MAX_CLIP_CHANNELS + clipChannel ], outputs are in FMOD_SPEAKER order //
+    const int tstride = ofxMultiSpeakerMixer::MAX_CLIP_CHANNELS;
+    float* tgains = mParams.gains;
+    std::fill( tgains, tgains + ofxMultiSpeakerMixer::MAX_OUTPUTS * tstride, 0.0f );
+    int tnumChannels = getNumChannels();
+    int tright = std::min( (int)FMOD_SPEAKER_FRONT_RIGHT, getNumOutputs() - 1 );
+
+    // like FMOD_Channel_SetPan, constant power for mono and balance for stereo, extra channels go to both sides //
+    if( tnumChannels == 1 ) {
+        float tangle = ( apan + 1.0f ) * 0.25f * (float)M_PI;
+        tgains[FMOD_SPEAKER_FRONT_LEFT * tstride] += cosf( tangle );
+        tgains[tright * tstride] += sinf( tangle );
+    } else {
+        float tleftGain = apan > 0.0f ? 1.0f - apan : 1.0f;
+        float trightGain = apan < 0.0f ? 1.0f + apan : 1.0f;
+        tgains[FMOD_SPEAKER_FRONT_LEFT * tstride] += tleftGain;
+        tgains[tright * tstride + 1] += trightGain;
+        for( int c = 2; c < tnumChannels; c++ ) {
+            tgains[FMOD_SPEAKER_FRONT_LEFT * tstride + c] += 0.5f * tleftGain;
+            tgains[tright * tstride + c] += 0.5f * trightGain;
+        }
+    }
+    mParams.bAmbisonic = false;
+    mBDirty = true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setSpeakerGains( const float* aspeakerGains ) {
+    const int tstride = ofxMultiSpeakerMixer::MAX_CLIP_CHANNELS;
+    float* tgains = mParams.gains;
+    std::fill( tgains, tgains + ofxMultiSpeakerMixer::MAX_OUTPUTS * tstride, 0.0f );
+    int tnumChannels = getNumChannels();
+    int tnumOutputs = getNumOutputs();
+    // every clip channel is spread the same way, averaged so a stereo file is not louder than a mono one //
+    float tscale = 1.0f / (float)tnumChannels;
+    for( int o = 0; o < tnumOutputs; o++ ) {
+        for( int c = 0; c < tnumChannels; c++ ) {
+            tgains[o * tstride + c] = aspeakerGains[o] * tscale;
+        }
+    }
+    mParams.bAmbisonic = false;
+    mBDirty = true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setAmbisonicGains( const float* again, int anumBusChannels, int anumChannels ) {
+    // the rows of the gain matrix are the acn channels of the mixer's bus //
+    const int tstride = ofxMultiSpeakerMixer::MAX_CLIP_CHANNELS;
+    float* tgains = mParams.gains;
+    std::fill( tgains, tgains + ofxMultiSpeakerMixer::MAX_OUTPUTS * tstride, 0.0f );
+    anumBusChannels = std::min( anumBusChannels, (int)ofxMultiSpeakerMixer::MAX_OUTPUTS );
+    anumChannels = std::min( anumChannels, tstride );
+    for( int k = 0; k < anumBusChannels; k++ ) {
+        for( int c = 0; c < anumChannels; c++ ) {
+            tgains[k * tstride + c] = again[k * anumChannels + c];
+        }
+    }
+    mParams.bAmbisonic = true;
+    mBDirty = true;
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::setAmbisonic( bool ab ) {
+    mParams.bAmbisonic = ab && getAmbisonicOrder() > 0;
+    mBDirty = true;
+}
+
+//--------------------
+int ofxMultiSpeakerMixerBackend::getAmbisonicOrder() const {
+    return mMixer != nullptr ? mMixer->getAmbisonicOrder() : 0;
+}
+
+//--------------------
+int ofxMultiSpeakerMixerBackend::getNumOutputs() const {
+    if( mMixer == nullptr ) return 0;
+    return std::min( mMixer->getSettings().numOutputs, (int)FMOD_SPEAKER_MAX );
+}
+
+//--------------------
+void ofxMultiSpeakerMixerBackend::startAt( unsigned long long aclock ) {
+    mParams.startClock = aclock;
+    mParams.bPaused = false;
+    mBDirty = true;
+}
+
+//--------------------
+unsigned long long ofxMultiSpeakerMixerBackend::getClock() const {
+    return mMixer->getClock();
+}
+
+//--------------------
+int ofxMultiSpeakerMixerBackend::getClockRate() const {
+    return mMixer->getSettings().sampleRate;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ofxMultiSpeakerPlayerBackend.h"
+#include "ofxMultiSpeakerMixer.h"
+
+// plays the file as a voice of an ofxMultiSpeakerMixer, the whole file is decoded on load //
+// setters only change a local copy of the voice parameters, commit() publishes them to the mixer in one go //
+class ofxMultiSpeakerMixerBackend : public ofxMultiSpeakerPlayerBackend {
+public:
+    ofxMultiSpeakerMixerBackend( ofxMultiSpeakerMixer* amixer ) : mMixer(amixer) {}
+    ~ofxMultiSpeakerMixerBackend();
+
+    ofxMultiSpeakerMixer* getMixer() const { return mMixer; }
+
+    bool load( std::string apath, bool abStream ) override;
+    void unload() override;
+    unsigned int getLength() const override;
+    int getNumChannels() const override;
+
+    bool open( bool abStopPrevious, bool abAmbisonic ) override;
+    bool commit() override;
+    void stop() override;
+    bool isPlaying() const override;
+
+    void setPaused( bool ab ) override;
+    // the mixer skips voices at 0 //
+    void setVolume( float again ) override;
+    void setSpeed( float aspeed ) override;
+    void setLoop( bool ab ) override;
+    void setPosition( unsigned int aframe ) override;
+    void setPositionMS( int ams ) override;
+    unsigned int getPosition() const override;
+    int getPositionMS() const override;
+
+    void setStereoPan( float apan ) override;
+    void setSpeakerGains( const float* aspeakerGains ) override;
+    void setAmbisonicGains( const float* again, int anumBusChannels, int anumChannels ) override;
+    void setAmbisonic( bool ab ) override;
+    int getAmbisonicOrder() const override;
+    int getNumOutputs() const override;
+
+    void startAt( unsigned long long aclock ) override;
+    const void* getClockDomain() const override { return mMixer; }
+    unsigned long long getClock() const override;
+    int getClockRate() const override;
+
+protected:
+    ofxMultiSpeakerMixer* mMixer = nullptr;
+    std::shared_ptr<const ofxMultiSpeakerMixer::Clip> mClip;
+    uint32_t mVoice = ofxMultiSpeakerMixer::INVALID_VOICE;
+    ofxMultiSpeakerMixer::VoiceParams mParams;
+    // opened, the mixer starts the voice on the next commit //
+    bool mBPending = false;
+    bool mBDirty = false;
+
+};
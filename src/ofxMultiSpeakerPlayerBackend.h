@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ofConstants.h"
+
+extern "C" {
+#include "fmod.h"
+}
+
+// the engine that plays one loaded file for ofxMultiSpeakerSoundPlayer //
+// the player keeps volume, pan, speed and the other settings, works out the gains and pushes the results here //
+// setters after open() may be collected until commit(), so call commit() after a group of changes //
+class ofxMultiSpeakerPlayerBackend {
+public:
+    virtual ~ofxMultiSpeakerPlayerBackend() {}
+
+    // apath is already a data path //
+    virtual bool load( std::string apath, bool abStream ) = 0;
+    virtual void unload() = 0;
+    // in frames //
+    virtual unsigned int getLength() const = 0;
+    virtual int getNumChannels() const = 0;
+    virtual bool isStreaming() const { return false; }
+
+    // opens a new paused voice with the default parameters, abStopPrevious stops the voice opened before //
+    virtual bool open( bool abStopPrevious, bool abAmbisonic ) = 0;
+    // hands the changes since the last commit to the engine, false when a newly opened voice could not start //
+    virtual bool commit() { return true; }
+    // once per frame work of the engine //
+    virtual void update() {}
+    virtual void stop() = 0;
+    virtual bool isPlaying() const = 0;
+    // false while the engine is still getting the opened voice ready, ie. filling stream buffers //
+    virtual bool isReady() const { return true; }
+
+    virtual void setPaused( bool ab ) = 0;
+    // final linear gain, volume times any normalize gain, 0 = silent //
+    virtual void setVolume( float again ) = 0;
+    // playback rate relative to the file's own rate //
+    virtual void setSpeed( float aspeed ) = 0;
+    virtual void setLoop( bool ab ) = 0;
+    // 0 = most important, 256 = least important //
+    virtual void setPriority( int ) {}
+    virtual void setPosition( unsigned int aframe ) = 0;
+    virtual void setPositionMS( int ams ) = 0;
+    virtual unsigned int getPosition() const = 0;
+    virtual int getPositionMS() const = 0;
+
+    // -1 to 1 between front left and front right //
+    virtual void setStereoPan( float apan ) = 0;
+    // gains per FMOD_SPEAKER, FMOD_SPEAKER_MAX of them, every channel of the file is sent the same way //
+    virtual void setSpeakerGains( const float* aspeakerGains ) = 0;
+    // encode gains of every file channel into the ambisonic bus, again[ acn * anumChannels + channel ] //
+    virtual void setAmbisonicGains( const float* again, int anumBusChannels, int anumChannels ) = 0;
+    // moves the voice onto the ambisonic bus or back to the speakers //
+    virtual void setAmbisonic( bool ab ) = 0;
+    // order of the bus ambisonic voices are encoded into, 0 = no bus //
+    virtual int getAmbisonicOrder() const = 0;
+    // speakers in FMOD_SPEAKER order that setSpeakerGains reaches //
+    virtual int getNumOutputs() const = 0;
+
+    // unpauses the opened voice so its first frame plays at aclock //
+    virtual void startAt( unsigned long long aclock ) = 0;
+    // backends that share a clock return the same domain, so the clock can be read once for all of them //
+    virtual const void* getClockDomain() const = 0;
+    virtual unsigned long long getClock() const = 0;
+    // clock ticks per second //
+    virtual int getClockRate() const = 0;
+
+    // fmod objects for spectrum analysis and waveforms, nullptr when the backend does not use fmod //
+    virtual FMOD_CHANNEL* getChannel() const { return nullptr; }
+    virtual FMOD_SOUND* getSound() const { return nullptr; }
+};
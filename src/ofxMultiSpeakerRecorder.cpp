@@ -0,0 +1,383 @@
+#include "ofxMultiSpeakerRecorder.h"
+#include "ofxMultiSpeakerSoundPlayer.h"
+#include "ofUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef TARGET_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// sony wave64 chunk ids //
+static const uint8_t W64_GUID_RIFF[16] = { 0x72,0x69,0x66,0x66, 0x2E,0x91, 0xCF,0x11, 0xA5,0xD6, 0x28,0xDB,0x04,0xC1,0x00,0x00 };
+static const uint8_t W64_GUID_WAVE[16] = { 0x77,0x61,0x76,0x65, 0xF3,0xAC, 0xD3,0x11, 0x8C,0xD1, 0x00,0xC0,0x4F,0x8E,0xDB,0x8A };
+static const uint8_t W64_GUID_FMT[16]  = { 0x66,0x6D,0x74,0x20, 0xF3,0xAC, 0xD3,0x11, 0x8C,0xD1, 0x00,0xC0,0x4F,0x8E,0xDB,0x8A };
+static const uint8_t W64_GUID_DATA[16] = { 0x64,0x61,0x74,0x61, 0xF3,0xAC, 0xD3,0x11, 0x8C,0xD1, 0x00,0xC0,0x4F,0x8E,0xDB,0x8A };
+// KSDATAFORMAT_SUBTYPE_IEEE_FLOAT //
+static const uint8_t WAV_GUID_FLOAT[16] = { 0x03,0x00,0x00,0x00, 0x00,0x00, 0x10,0x00, 0x80,0x00, 0x00,0xAA,0x00,0x38,0x9B,0x71 };
+
+static const uint64_t WAV_HEADER_SIZE = 68;
+static const uint64_t W64_HEADER_SIZE = 128;
+
+//--------------------
+static void pushLE( std::vector<uint8_t>& abytes, uint64_t avalue, int anumBytes ) {
+    for( int i = 0; i < anumBytes; i++ ) {
+        abytes.push_back( (uint8_t)((avalue >> (8*i)) & 0xFF) );
+    }
+}
+
+//--------------------
+static void pushBytes( std::vector<uint8_t>& abytes, const uint8_t* adata, int anumBytes ) {
+    abytes.insert( abytes.end(), adata, adata+anumBytes );
+}
+
+//--------------------
+static void pushTag( std::vector<uint8_t>& abytes, const char* atag ) {
+    pushBytes( abytes, (const uint8_t*)atag, 4 );
+}
+
+//--------------------
+static uint32_t getWavChannelMask( int anumChannels ) {
+    // only set a mask where the fmod channel order matches the wav channel order //
+    if( anumChannels == 1 ) return 0x4;
+    if( anumChannels == 2 ) return 0x3;
+    if( anumChannels == 6 ) return 0x60F;
+    return 0;
+}
+
+//--------------------
+ofxMultiSpeakerRecorder::ofxMultiSpeakerRecorder() {
+
+}
+
+//--------------------
+ofxMultiSpeakerRecorder::~ofxMultiSpeakerRecorder() {
+    stop();
+}
+
+//--------------------
+bool ofxMultiSpeakerRecorder::start( Settings asettings ) {
+    if( mBRecording ) {
+        ofLogWarning("ofxMultiSpeakerRecorder :: start : already recording, stopping ") << mSettings.filePath;
+        stop();
+    }
+
+    FMOD_SYSTEM* tsys = ofxMultiSpeakerSoundPlayer::getSystem();
+    FMOD_CHANNELGROUP* tgroup = ofxMultiSpeakerSoundPlayer::getMasterChannelGroup();
+    if( tsys == nullptr || tgroup == nullptr ) {
+        ofLogError("ofxMultiSpeakerRecorder :: start : fmod is not initialized, call ofxMultiSpeakerSoundPlayer::initializeFmod() first");
+        return false;
+    }
+    if( asettings.filePath == "" ) {
+        ofLogError("ofxMultiSpeakerRecorder :: start : no file path set");
+        return false;
+    }
+
+    mSettings = asettings;
+    mSettings.writeBlockFrames = std::max( mSettings.writeBlockFrames, 1024u );
+
+    FMOD_SPEAKERMODE tmode = FMOD_SPEAKERMODE_STEREO;
+    int tnumRaw = 0;
+    FMOD_System_GetSoftwareFormat(tsys, &mSampleRate, &tmode, &tnumRaw);
+    mNumChannels = 0;
+    if( tmode == FMOD_SPEAKERMODE_RAW ) {
+        mNumChannels = tnumRaw;
+    } else {
+        FMOD_System_GetSpeakerModeChannels(tsys, tmode, &mNumChannels);
+    }
+    if( mNumChannels < 1 || mSampleRate < 1 ) {
+        ofLogError("ofxMultiSpeakerRecorder :: start : unable to get the fmod output format");
+        return false;
+    }
+
+    // the ring has to hold at least a couple of write blocks so the mixer never waits on the writer //
+    mRingFrames = std::max( (size_t)(mSettings.ringBufferSeconds * (float)mSampleRate), (size_t)mSettings.writeBlockFrames * 2 );
+    mRing.assign( mRingFrames * mNumChannels, 0.0f );
+    mRingWrite = 0;
+    mRingRead = 0;
+    mFramesWritten = 0;
+    mDroppedBlocks = 0;
+    mDroppedFrames = 0;
+    mWriteErrors = 0;
+    mDataBytes = 0;
+
+    string tpath = ofToDataPath( mSettings.filePath );
+    mFile = fopen( tpath.c_str(), "wb" );
+    if( mFile == nullptr ) {
+        ofLogError("ofxMultiSpeakerRecorder :: start : unable to open file for writing: ") << tpath;
+        return false;
+    }
+    mFileBuffer.resize( (size_t)mSettings.writeBlockFrames * mNumChannels * sizeof(float) );
+    setvbuf( mFile, mFileBuffer.data(), _IOFBF, mFileBuffer.size() );
+
+    if( !writeHeader() ) {
+        ofLogError("ofxMultiSpeakerRecorder :: start : unable to write header: ") << tpath;
+        discardFile( tpath );
+        return false;
+    }
+
+#ifdef TARGET_LINUX
+    if( mSettings.preallocateSeconds > 0.0f ) {
+        uint64_t treserve = (uint64_t)(mSettings.preallocateSeconds * (float)mSampleRate) * mNumChannels * sizeof(float);
+        int tres = posix_fallocate( fileno(mFile), 0, (off_t)(treserve + W64_HEADER_SIZE) );
+        if( tres != 0 ) {
+            ofLogWarning("ofxMultiSpeakerRecorder :: start : unable to preallocate file space, error: ") << tres;
+        }
+    }
+#endif
+
+    mBThreadRunning = true;
+    mThread = std::thread( &ofxMultiSpeakerRecorder::writerThread, this );
+
+    FMOD_DSP_DESCRIPTION tdesc;
+    memset( &tdesc, 0, sizeof(tdesc) );
+    tdesc.pluginsdkversion = FMOD_PLUGIN_SDK_VERSION;
+    strncpy( tdesc.name, "ofxMSRecorder", sizeof(tdesc.name)-1 );
+    tdesc.version = 1;
+    tdesc.numinputbuffers = 1;
+    tdesc.numoutputbuffers = 1;
+    tdesc.read = &ofxMultiSpeakerRecorder::dspRead;
+
+    FMOD_RESULT tresult = FMOD_System_CreateDSP(tsys, &tdesc, &mDsp);
+    if( tresult == FMOD_OK ) {
+        FMOD_DSP_SetUserData(mDsp, this);
+        mBCapture = true;
+        tresult = FMOD_ChannelGroup_AddDSP(tgroup, FMOD_CHANNELCONTROL_DSP_HEAD, mDsp);
+    }
+    if( tresult != FMOD_OK ) {
+        ofLogError("ofxMultiSpeakerRecorder :: start : unable to add capture dsp to master group");
+        mBCapture = false;
+        if( mDsp != nullptr ) {
+            FMOD_DSP_Release(mDsp);
+            mDsp = nullptr;
+        }
+        // nothing was captured, so do not leave an empty recording behind //
+        mBThreadRunning = false;
+        if( mThread.joinable() ) {
+            mThread.join();
+        }
+        discardFile( tpath );
+        return false;
+    }
+    mChannelGroup = tgroup;
+    mBRecording = true;
+
+    ofLogNotice("ofxMultiSpeakerRecorder :: start : recording ") << mNumChannels << " channels at " << mSampleRate << " to " << tpath;
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerRecorder::discardFile( std::string apath ) {
+    if( mFile != nullptr ) {
+        fclose( mFile );
+        mFile = nullptr;
+    }
+    if( std::remove( apath.c_str() ) != 0 ) {
+        ofLogWarning("ofxMultiSpeakerRecorder :: unable to remove ") << apath;
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerRecorder::stop() {
+    if( !mBRecording ) return;
+    mBCapture = false;
+
+    // removing the dsp takes the fmod dsp lock, so the mixer is no longer in dspRead after this //
+    if( mDsp != nullptr ) {
+        if( ofxMultiSpeakerSoundPlayer::getSystem() != nullptr ) {
+            FMOD_ChannelGroup_RemoveDSP(mChannelGroup, mDsp);
+            FMOD_DSP_Release(mDsp);
+        }
+        mDsp = nullptr;
+    }
+    mChannelGroup = nullptr;
+
+    // the writer drains whatever is left in the ring before exiting //
+    mBThreadRunning = false;
+    if( mThread.joinable() ) {
+        mThread.join();
+    }
+
+    if( mFile != nullptr ) {
+        if( mSettings.format == FORMAT_W64 && (mDataBytes % 8) != 0 ) {
+            // w64 chunks are 8 byte aligned //
+            uint8_t tpad[8] = {0,0,0,0,0,0,0,0};
+            writeBytes( tpad, 8 - (mDataBytes % 8) );
+        }
+        fflush( mFile );
+#ifdef TARGET_LINUX
+        // give back the preallocated space that was not used //
+        uint64_t theaderSize = mSettings.format == FORMAT_W64 ? W64_HEADER_SIZE : WAV_HEADER_SIZE;
+        uint64_t tfileSize = theaderSize + mDataBytes;
+        if( mSettings.format == FORMAT_W64 ) tfileSize = theaderSize + ((mDataBytes + 7) / 8) * 8;
+        if( ftruncate( fileno(mFile), (off_t)tfileSize ) != 0 ) {
+            ofLogWarning("ofxMultiSpeakerRecorder :: stop : unable to trim preallocated file space");
+        }
+#endif
+        fseek( mFile, 0, SEEK_SET );
+        if( !writeHeader() ) {
+            ofLogError("ofxMultiSpeakerRecorder :: stop : unable to update header: ") << mSettings.filePath;
+        }
+        fclose( mFile );
+        mFile = nullptr;
+    }
+
+    ofLogNotice("ofxMultiSpeakerRecorder :: stop : wrote ") << mFramesWritten.load() << " frames to " << mSettings.filePath << " dropped blocks: " << mDroppedBlocks.load() << " write errors: " << mWriteErrors.load();
+
+    mRing.clear();
+    mRing.shrink_to_fit();
+    mBRecording = false;
+}
+
+//--------------------
+FMOD_RESULT F_CALL ofxMultiSpeakerRecorder::dspRead( FMOD_DSP_STATE* dsp_state, float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int* outchannels ) {
+    // pass the mix through untouched //
+    if( *outchannels == inchannels ) {
+        memcpy( outbuffer, inbuffer, sizeof(float) * length * inchannels );
+    } else {
+        for( unsigned int i = 0; i < length; i++ ) {
+            for( int c = 0; c < *outchannels; c++ ) {
+                outbuffer[i * *outchannels + c] = c < inchannels ? inbuffer[i * inchannels + c] : 0.0f;
+            }
+        }
+    }
+
+    void* tuserData = nullptr;
+    FMOD_DSP_GetUserData((FMOD_DSP*)dsp_state->instance, &tuserData);
+    ofxMultiSpeakerRecorder* trecorder = (ofxMultiSpeakerRecorder*)tuserData;
+    if( trecorder != nullptr && trecorder->mBCapture.load(std::memory_order_acquire) ) {
+        trecorder->pushBlock( inbuffer, length, inchannels );
+    }
+    return FMOD_OK;
+}
+
+// called from the mixer thread, never blocks //
+//--------------------
+void ofxMultiSpeakerRecorder::pushBlock( const float* abuffer, unsigned int aframes, int achannels ) {
+    uint64_t twrite = mRingWrite.load(std::memory_order_relaxed);
+    uint64_t tread = mRingRead.load(std::memory_order_acquire);
+    size_t tfree = mRingFrames - (size_t)(twrite - tread);
+    if( aframes > tfree ) {
+        mDroppedBlocks.fetch_add(1, std::memory_order_relaxed);
+        mDroppedFrames.fetch_add(aframes, std::memory_order_relaxed);
+        return;
+    }
+
+    size_t tstart = (size_t)(twrite % mRingFrames);
+    if( achannels == mNumChannels ) {
+        size_t tfirst = std::min( (size_t)aframes, mRingFrames - tstart );
+        memcpy( &mRing[tstart * mNumChannels], abuffer, tfirst * mNumChannels * sizeof(float) );
+        if( tfirst < aframes ) {
+            memcpy( &mRing[0], abuffer + tfirst * mNumChannels, (aframes - tfirst) * mNumChannels * sizeof(float) );
+        }
+    } else {
+        for( unsigned int i = 0; i < aframes; i++ ) {
+            float* tframe = &mRing[((tstart + i) % mRingFrames) * mNumChannels];
+            for( int c = 0; c < mNumChannels; c++ ) {
+                tframe[c] = c < achannels ? abuffer[i * achannels + c] : 0.0f;
+            }
+        }
+    }
+    mRingWrite.store( twrite + aframes, std::memory_order_release );
+}
+
+//--------------------
+size_t ofxMultiSpeakerRecorder::popFrames( float* aOut, size_t aMaxFrames ) {
+    uint64_t tread = mRingRead.load(std::memory_order_relaxed);
+    uint64_t twrite = mRingWrite.load(std::memory_order_acquire);
+    size_t tnum = std::min( (size_t)(twrite - tread), aMaxFrames );
+    if( tnum == 0 ) return 0;
+
+    size_t tstart = (size_t)(tread % mRingFrames);
+    size_t tfirst = std::min( tnum, mRingFrames - tstart );
+    memcpy( aOut, &mRing[tstart * mNumChannels], tfirst * mNumChannels * sizeof(float) );
+    if( tfirst < tnum ) {
+        memcpy( aOut + tfirst * mNumChannels, &mRing[0], (tnum - tfirst) * mNumChannels * sizeof(float) );
+    }
+    mRingRead.store( tread + tnum, std::memory_order_release );
+    return tnum;
+}
+
+//--------------------
+void ofxMultiSpeakerRecorder::writerThread() {
+    std::vector<float> tblock( (size_t)mSettings.writeBlockFrames * mNumChannels, 0.0f );
+    while( true ) {
+        bool brunning = mBThreadRunning.load();
+        size_t tavailable = (size_t)(mRingWrite.load(std::memory_order_acquire) - mRingRead.load(std::memory_order_relaxed));
+        // wait for a full block so the file gets large sequential writes //
+        if( brunning && tavailable < mSettings.writeBlockFrames ) {
+            std::this_thread::sleep_for( std::chrono::milliseconds(10) );
+            continue;
+        }
+        size_t tnum = popFrames( tblock.data(), mSettings.writeBlockFrames );
+        if( tnum > 0 ) {
+            size_t tbytes = tnum * mNumChannels * sizeof(float);
+            if( writeBytes( tblock.data(), tbytes ) ) {
+                mDataBytes += tbytes;
+                mFramesWritten.fetch_add( tnum );
+            }
+        } else if( !brunning ) {
+            break;
+        }
+    }
+}
+
+//--------------------
+bool ofxMultiSpeakerRecorder::writeHeader() {
+    std::vector<uint8_t> theader;
+    uint32_t tblockAlign = mNumChannels * sizeof(float);
+
+    // format chunk contents, WAVE_FORMAT_EXTENSIBLE with 32 bit float samples //
+    std::vector<uint8_t> tfmt;
+    pushLE( tfmt, 0xFFFE, 2 );
+    pushLE( tfmt, mNumChannels, 2 );
+    pushLE( tfmt, mSampleRate, 4 );
+    pushLE( tfmt, (uint64_t)mSampleRate * tblockAlign, 4 );
+    pushLE( tfmt, tblockAlign, 2 );
+    pushLE( tfmt, 32, 2 );
+    pushLE( tfmt, 22, 2 );
+    pushLE( tfmt, 32, 2 );
+    pushLE( tfmt, getWavChannelMask(mNumChannels), 4 );
+    pushBytes( tfmt, WAV_GUID_FLOAT, 16 );
+
+    if( mSettings.format == FORMAT_W64 ) {
+        uint64_t tpaddedData = ((mDataBytes + 7) / 8) * 8;
+        pushBytes( theader, W64_GUID_RIFF, 16 );
+        pushLE( theader, W64_HEADER_SIZE + tpaddedData, 8 );
+        pushBytes( theader, W64_GUID_WAVE, 16 );
+        pushBytes( theader, W64_GUID_FMT, 16 );
+        pushLE( theader, 24 + tfmt.size(), 8 );
+        pushBytes( theader, tfmt.data(), (int)tfmt.size() );
+        pushBytes( theader, W64_GUID_DATA, 16 );
+        pushLE( theader, 24 + mDataBytes, 8 );
+    } else {
+        uint64_t tdataBytes = mDataBytes;
+        if( tdataBytes > 0xFFFFFFFFull - WAV_HEADER_SIZE ) {
+            ofLogWarning("ofxMultiSpeakerRecorder :: wav file is larger than 4GB, use FORMAT_W64 for long recordings");
+            tdataBytes = 0xFFFFFFFFull - WAV_HEADER_SIZE;
+        }
+        pushTag( theader, "RIFF" );
+        pushLE( theader, WAV_HEADER_SIZE - 8 + tdataBytes, 4 );
+        pushTag( theader, "WAVE" );
+        pushTag( theader, "fmt " );
+        pushLE( theader, tfmt.size(), 4 );
+        pushBytes( theader, tfmt.data(), (int)tfmt.size() );
+        pushTag( theader, "data" );
+        pushLE( theader, tdataBytes, 4 );
+    }
+    return fwrite( theader.data(), 1, theader.size(), mFile ) == theader.size();
+}
+
+//--------------------
+bool ofxMultiSpeakerRecorder::writeBytes( const void* adata, size_t asize ) {
+    if( mFile == nullptr ) return false;
+    if( fwrite( adata, 1, asize, mFile ) != asize ) {
+        mWriteErrors.fetch_add( 1 );
+        return false;
+    }
+    return true;
+}
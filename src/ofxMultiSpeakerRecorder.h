@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ofConstants.h"
+
+#include <atomic>
+#include <thread>
+#include <cstdio>
+
+extern "C" {
+#include "fmod.h"
+}
+
+// records the master output of ofxMultiSpeakerSoundPlayer to disk //
+// the mixer thread only copies each block into a ring buffer, a writer thread does the file io //
+class ofxMultiSpeakerRecorder {
+public:
+
+    enum FileFormat {
+        FORMAT_WAV=0,
+        // sony wave64, no 4GB limit, use for long recordings //
+        FORMAT_W64
+    };
+
+    struct Settings {
+        std::string filePath = "";
+        FileFormat format = FORMAT_W64;
+        // seconds of audio the ring buffer holds before mix blocks are dropped //
+        float ringBufferSeconds = 4.0f;
+        // file space reserved when the recording starts, the file is trimmed on stop //
+        float preallocateSeconds = 60.0f * 60.0f;
+        // frames collected before each write to disk //
+        unsigned int writeBlockFrames = 32768;
+    };
+
+    ofxMultiSpeakerRecorder();
+    ~ofxMultiSpeakerRecorder();
+
+    // fmod needs to be initialized, records 32 bit float with the channel count of the fmod speaker mode //
+    bool start( Settings asettings );
+    void stop();
+    bool isRecording() const { return mBRecording; }
+
+    int getNumChannels() const { return mNumChannels; }
+    int getSampleRate() const { return mSampleRate; }
+    uint64_t getNumFramesWritten() const { return mFramesWritten.load(); }
+    // mix blocks that did not fit into the ring buffer //
+    uint64_t getNumDroppedBlocks() const { return mDroppedBlocks.load(); }
+    uint64_t getNumDroppedFrames() const { return mDroppedFrames.load(); }
+    // failed or short writes to the file //
+    uint64_t getNumWriteErrors() const { return mWriteErrors.load(); }
+
+protected:
+    static FMOD_RESULT F_CALL dspRead( FMOD_DSP_STATE* dsp_state, float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int* outchannels );
+
+    void pushBlock( const float* abuffer, unsigned int aframes, int achannels );
+    size_t popFrames( float* aOut, size_t aMaxFrames );
+    void writerThread();
+    bool writeHeader();
+    bool writeBytes( const void* adata, size_t asize );
+    // closes and deletes a file that start() could not finish setting up //
+    void discardFile( std::string apath );
+
+    Settings mSettings;
+    bool mBRecording = false;
+    int mNumChannels = 0;
+    int mSampleRate = 0;
+
+    FMOD_DSP* mDsp = nullptr;
+    FMOD_CHANNELGROUP* mChannelGroup = nullptr;
+
+    // single producer ( mixer ), single consumer ( writer ), interleaved float frames //
+    std::vector<float> mRing;
+    size_t mRingFrames = 0;
+    std::atomic<uint64_t> mRingWrite{0};
+    std::atomic<uint64_t> mRingRead{0};
+
+    std::atomic<bool> mBCapture{false};
+    std::atomic<bool> mBThreadRunning{false};
+    std::atomic<uint64_t> mFramesWritten{0};
+    std::atomic<uint64_t> mDroppedBlocks{0};
+    std::atomic<uint64_t> mDroppedFrames{0};
+    std::atomic<uint64_t> mWriteErrors{0};
+
+    std::thread mThread;
+    FILE* mFile = nullptr;
+    std::vector<char> mFileBuffer;
+    uint64_t mDataBytes = 0;
+
+};
@@ -1,5 +1,22 @@
 #include "ofxMultiSpeakerSoundPlayer.h"
+#include "ofxMultiSpeakerLoudness.h"
+#include "ofxMultiSpeakerTrace.h"
+#include "ofxMultiSpeakerFmodBackend.h"
+#include "ofxMultiSpeakerMixerBackend.h"
 #include "ofUtils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <chrono>
+#include <unordered_map>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OFX_MULTI_SPEAKER_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OFX_MULTI_SPEAKER_NEON
+#endif
 
 using namespace std;
 
@@ -7,16 +24,74 @@ bool bFmodSysInited = false;
 bool bFmodInitialized_ = false;
 //bool bUseSpectrum_ = false;
 //float fftValues_[8192];			//
-float fftInterpValues_[8192];			//
-float fftSpectrum_[8192];		// maximum #ofxMultiSpeakerSoundPlayer is 8192, in fmodex....
+float fftInterpValues_[8192];			// maximum #ofxMultiSpeakerSoundPlayer is 8192, in fmodex....
 static unsigned int buffersize = 1024;
-static FMOD_DSP* fftDSP = NULL;
 
 // ---------------------  static vars
 static FMOD_CHANNELGROUP * channelgroup = nullptr;
 static FMOD_SYSTEM       * sys = nullptr;
 
 ofxMultiSpeakerSoundPlayer::FmodSettings ofxMultiSpeakerSoundPlayer::sFmodSettings;
+ofxMultiSpeakerSoundPlayer::SpectrumAnalyzer ofxMultiSpeakerSoundPlayer::sMasterSpectrum;
+std::vector<ofxMultiSpeakerSoundPlayer::SpectrumAnalyzer*> ofxMultiSpeakerSoundPlayer::sSpectrumAnalyzers;
+ofxMultiSpeakerLoudness* ofxMultiSpeakerSoundPlayer::sLoudnessAnalyzer = nullptr;
+ofxMultiSpeakerMixer* ofxMultiSpeakerSoundPlayer::sSoftwareMixer = nullptr;
+ofxMultiSpeakerSoundPlayer::AmbisonicBus ofxMultiSpeakerSoundPlayer::sAmbisonicBus;
+std::vector<ofxMultiSpeakerSoundPlayer::BatchEntry> ofxMultiSpeakerSoundPlayer::sBatch;
+bool ofxMultiSpeakerSoundPlayer::sBBatching = false;
+ofxMultiSpeakerSoundPlayer::GovernorSettings ofxMultiSpeakerSoundPlayer::sGovernorSettings;
+ofxMultiSpeakerSoundPlayer::GovernorState ofxMultiSpeakerSoundPlayer::sGovernorState;
+std::vector<ofxMultiSpeakerSoundPlayer::GovernorAdjustment> ofxMultiSpeakerSoundPlayer::sGovernorAdjustments;
+int ofxMultiSpeakerSoundPlayer::sGovernorHoldUpdates = 0;
+bool ofxMultiSpeakerSoundPlayer::sBGovernorCapActive = false;
+std::vector<ofxMultiSpeakerSoundPlayer*> ofxMultiSpeakerSoundPlayer::sGovernorRanked;
+
+// degrees between the first and last channel of a multi channel file on the ambisonic bus //
+static const float AMBISONIC_CHANNEL_SPREAD = 60.0f;
+
+// commitBatch scratch, kept so committing does not allocate once the sizes have settled //
+static std::vector<int> sBatchRows;
+static std::vector<float> sBatchPans;
+static std::vector<float> sBatchNumSpeakers;
+static std::vector<float> sBatchGains;
+std::vector<ofxMultiSpeakerSoundPlayer::RetiredWaveformBuild> ofxMultiSpeakerSoundPlayer::sRetiredWaveformBuilds;
+// the players by getId(), so cues can name players that may have been destroyed //
+// function local like getPlayerList(), players that are globals in other files register before main() //
+static std::unordered_map<uint32_t, ofxMultiSpeakerSoundPlayer*>& getPlayersById() {
+    static std::unordered_map<uint32_t, ofxMultiSpeakerSoundPlayer*> sPlayersById;
+    return sPlayersById;
+}
+static uint32_t sNextPlayerId = 0;
+
+ofxMultiSpeakerSoundPlayer::CueSettings ofxMultiSpeakerSoundPlayer::sCueSettings;
+// bounded multi producer queue, every slot has a sequence number telling producers and the consumer whose turn it is //
+struct CueSlot {
+    std::atomic<size_t> sequence{0};
+    ofxMultiSpeakerSoundPlayer::Cue cue;
+};
+struct CueQueue {
+    CueQueue() {
+        slots.reset( new CueSlot[ofxMultiSpeakerSoundPlayer::CUE_QUEUE_SIZE] );
+        for( size_t i = 0; i < ofxMultiSpeakerSoundPlayer::CUE_QUEUE_SIZE; i++ ) {
+            slots[i].sequence.store( i, std::memory_order_relaxed );
+        }
+    }
+    std::unique_ptr<CueSlot[]> slots;
+    std::atomic<size_t> enqueuePos{0};
+    // only touched by updateSound() //
+    size_t dequeuePos = 0;
+    std::atomic<uint64_t> numTriggered{0};
+    std::atomic<uint64_t> numDropped{0};
+    uint64_t numPlayed = 0;
+    uint64_t numFailed = 0;
+    uint64_t numUnknownPlayer = 0;
+    uint64_t numLate = 0;
+};
+// function local, trigger() may be called before main() //
+static CueQueue& getCueQueue() {
+    static CueQueue sCueQueue;
+    return sCueQueue;
+}
 
 // these are global functions, that affect every sound / channel:
 // ------------------------------------------------------------
@@ -25,31 +100,32 @@ ofxMultiSpeakerSoundPlayer::FmodSettings ofxMultiSpeakerSoundPlayer::sFmodSettin
 //--------------------
 void fmodStopAll() {
     ofxMultiSpeakerSoundPlayer::initializeFmod();
-    FMOD_ChannelGroup_Stop(channelgroup);
+    OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_Stop(channelgroup) );
 }
 
 //--------------------
 void fmodSetVolume(float vol) {
     ofxMultiSpeakerSoundPlayer::initializeFmod();
-    FMOD_ChannelGroup_SetVolume(channelgroup, vol);
+    OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_SetVolume(channelgroup, vol) );
 }
 
 //--------------------
 void fmodSoundUpdate() {
+    OFX_MS_TRACE_SCOPE( "fmodSoundUpdate" );
     if (bFmodInitialized_) {
-        FMOD_System_Update(sys);
+        OFX_MS_TRACE_FMOD( FMOD_System_Update(sys) );
     }
 }
 
 //--------------------
 float * fmodSoundGetSpectrum(int nBands) {
+    OFX_MS_TRACE_SCOPE( "fmodSoundGetSpectrum" );
 
     ofxMultiSpeakerSoundPlayer::initializeFmod();
 
     // 	set to 0
     for (int i = 0; i < 8192; i++){
         fftInterpValues_[i] = 0;
-        fftSpectrum_[i] = 0;
     }
 
     // 	check what the user wants vs. what we can do:
@@ -62,59 +138,72 @@ float * fmodSoundGetSpectrum(int nBands) {
         return fftInterpValues_;
     }
 
-    //  get the fft
-    //  useful info here: https://www.parallelcube.com/2018/03/10/frequency-spectrum-using-fmod-and-ue4/
-    if( fftDSP == NULL ){
-        FMOD_System_CreateDSPByType(sys, FMOD_DSP_TYPE_FFT,&fftDSP);
-        FMOD_ChannelGroup_AddDSP(channelgroup,0,fftDSP);
-        FMOD_DSP_SetParameterInt(fftDSP, FMOD_DSP_FFT_WINDOWTYPE, FMOD_DSP_FFT_WINDOW_HANNING);
+    // all of the speakers on the master group //
+    auto tbands = ofxMultiSpeakerSoundPlayer::getSpeakerSpectrum( {}, nBands );
+    for( int i = 0; i < (int)tbands.size(); i++ ) {
+        fftInterpValues_[i] = tbands[i];
     }
 
-    if( fftDSP != NULL ){
-        FMOD_DSP_PARAMETER_FFT *fft;
-        auto result = FMOD_DSP_GetParameterData(fftDSP, FMOD_DSP_FFT_SPECTRUMDATA, (void **)&fft, 0, 0, 0);
-        if( result == 0 ){
-
-            // Only read / display half of the buffer typically for analysis
-            // as the 2nd half is usually the same data reversed due to the nature of the way FFT works. ( comment from link above )
-            int length = fft->length/2;
-            if( length > 0 ){
-
-                std::vector <float> avgValCount;
-                avgValCount.assign(nBands, 0.0); 
-
-                float normalizedBand = 0;
-                float normStep = 1.0 / (float)length;
-
-                for (int bin = 0; bin < length; bin++){
-                    //should map 0 to nBands but accounting for lower frequency bands being more important
-                    int logIndexBand = log10(1.0 + normalizedBand*9.0) * nBands;
-
-                    //get both channels as that is what the old FMOD call did
-                    for (int channel = 0; channel < fft->numchannels; channel++){
-                        fftSpectrum_[logIndexBand] += fft->spectrum[channel][bin];
-                        avgValCount[logIndexBand] += 1.0;
-                    }
-
-                    normalizedBand += normStep;
-                }
+    return fftInterpValues_;
+}
 
-                //average the remapped bands based on how many times we added to each bin
-                for(int i = 0; i < nBands; i++){
-                    if( avgValCount[i] > 1.0 ){
-                        fftSpectrum_[i] /= avgValCount[i];
-                    }
-                }
-            }
+//--------------------
+static void waveformReduce( const float* adata, int anum, float& aOutMin, float& aOutMax, float& aOutSumSquares ) {
+    float tmin = adata[0];
+    float tmax = adata[0];
+    float tsum = 0.0f;
+    int i = 0;
+#if defined(OFX_MULTI_SPEAKER_SSE)
+    if( anum >= 4 ) {
+        __m128 vmin = _mm_loadu_ps( adata );
+        __m128 vmax = vmin;
+        __m128 vsum = _mm_setzero_ps();
+        for( ; i + 4 <= anum; i += 4 ) {
+            __m128 v = _mm_loadu_ps( adata + i );
+            vmin = _mm_min_ps( vmin, v );
+            vmax = _mm_max_ps( vmax, v );
+            vsum = _mm_add_ps( vsum, _mm_mul_ps(v, v) );
+        }
+        float tmins[4], tmaxs[4], tsums[4];
+        _mm_storeu_ps( tmins, vmin );
+        _mm_storeu_ps( tmaxs, vmax );
+        _mm_storeu_ps( tsums, vsum );
+        for( int k = 0; k < 4; k++ ) {
+            tmin = std::min( tmin, tmins[k] );
+            tmax = std::max( tmax, tmaxs[k] );
+            tsum += tsums[k];
         }
     }
-
-    // 	convert to db scale
-    for(int i = 0; i < nBands; i++){
-        fftInterpValues_[i] = 10.0f * (float)log10(1 + fftSpectrum_[i]) * 2.0f;
+#elif defined(OFX_MULTI_SPEAKER_NEON)
+    if( anum >= 4 ) {
+        float32x4_t vmin = vld1q_f32( adata );
+        float32x4_t vmax = vmin;
+        float32x4_t vsum = vdupq_n_f32( 0.0f );
+        for( ; i + 4 <= anum; i += 4 ) {
+            float32x4_t v = vld1q_f32( adata + i );
+            vmin = vminq_f32( vmin, v );
+            vmax = vmaxq_f32( vmax, v );
+            vsum = vmlaq_f32( vsum, v, v );
+        }
+        float tmins[4], tmaxs[4], tsums[4];
+        vst1q_f32( tmins, vmin );
+        vst1q_f32( tmaxs, vmax );
+        vst1q_f32( tsums, vsum );
+        for( int k = 0; k < 4; k++ ) {
+            tmin = std::min( tmin, tmins[k] );
+            tmax = std::max( tmax, tmaxs[k] );
+            tsum += tsums[k];
+        }
     }
-
-    return fftInterpValues_;
+#endif
+    for( ; i < anum; i++ ) {
+        tmin = std::min( tmin, adata[i] );
+        tmax = std::max( tmax, adata[i] );
+        tsum += adata[i] * adata[i];
+    }
+    aOutMin = tmin;
+    aOutMax = tmax;
+    aOutSumSquares = tsum;
 }
 
 //--------------------
@@ -245,20 +334,615 @@ std::vector<std::string> ofxMultiSpeakerSoundPlayer::getSpeakerNameList() {
     return tSpeakerNames;
 }
 
+//--------------------------------------------------
+int ofxMultiSpeakerSoundPlayer::getSpeakerChannel( FMOD_SPEAKER aspeaker, FMOD_SPEAKERMODE amode ) {
+    if( aspeaker <= FMOD_SPEAKER_NONE || aspeaker >= FMOD_SPEAKER_MAX ) return -1;
+    // quad and surround skip speakers, the other modes keep the FMOD_SPEAKER order up to their width //
+    static const FMOD_SPEAKER sQuadSpeakers[] = { FMOD_SPEAKER_FRONT_LEFT, FMOD_SPEAKER_FRONT_RIGHT, FMOD_SPEAKER_SURROUND_LEFT, FMOD_SPEAKER_SURROUND_RIGHT };
+    static const FMOD_SPEAKER sSurroundSpeakers[] = { FMOD_SPEAKER_FRONT_LEFT, FMOD_SPEAKER_FRONT_RIGHT, FMOD_SPEAKER_FRONT_CENTER, FMOD_SPEAKER_SURROUND_LEFT, FMOD_SPEAKER_SURROUND_RIGHT };
+    if( amode == FMOD_SPEAKERMODE_QUAD ) {
+        for( int i = 0; i < 4; i++ ) {
+            if( sQuadSpeakers[i] == aspeaker ) return i;
+        }
+        return -1;
+    } else if( amode == FMOD_SPEAKERMODE_SURROUND ) {
+        for( int i = 0; i < 5; i++ ) {
+            if( sSurroundSpeakers[i] == aspeaker ) return i;
+        }
+        return -1;
+    }
+
+    int tnumChannels = FMOD_SPEAKER_MAX;
+    if( amode == FMOD_SPEAKERMODE_MONO ) {
+        tnumChannels = 1;
+    } else if( amode == FMOD_SPEAKERMODE_STEREO ) {
+        tnumChannels = 2;
+    } else if( amode == FMOD_SPEAKERMODE_5POINT1 ) {
+        tnumChannels = 6;
+    } else if( amode == FMOD_SPEAKERMODE_7POINT1 ) {
+        tnumChannels = 8;
+    }
+    return (int)aspeaker < tnumChannels ? (int)aspeaker : -1;
+}
+
+//--------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::setMasterSpectrumSettings( SpectrumSettings asettings ) {
+    sMasterSpectrum.settings = asettings;
+    applySpectrumSettings( sMasterSpectrum );
+}
+
+//--------------------------------------------------
+std::vector<float> ofxMultiSpeakerSoundPlayer::getSpeakerSpectrum( std::vector<FMOD_SPEAKER> aspeakers, int nBands ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::getSpeakerSpectrum" );
+    initializeFmod();
+    nBands = ofClamp( nBands, 1, 8192 );
+    std::vector<float> rbands( nBands, 0.0f );
+
+    if( sMasterSpectrum.dsp == nullptr ) {
+        if( createSpectrumDSP( sMasterSpectrum ) == nullptr ) {
+            return rbands;
+        }
+        if( OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_AddDSP(channelgroup, 0, sMasterSpectrum.dsp) ) == FMOD_OK ) {
+            sMasterSpectrum.attachedGroup = channelgroup;
+        }
+    }
+
+    // the order of the master mix channels depends on the speaker mode //
+    FMOD_SPEAKERMODE tmode = sFmodSettings.speakerMode;
+    OFX_MS_TRACE_FMOD( FMOD_System_GetSoftwareFormat(sys, NULL, &tmode, NULL) );
+    std::vector<int> tchannels;
+    for( auto& speaker : aspeakers ) {
+        int tchannel = getSpeakerChannel( speaker, tmode );
+        if( tchannel > -1 ) {
+            tchannels.push_back( tchannel );
+        }
+    }
+    // none of the speakers are in the output //
+    if( tchannels.empty() && !aspeakers.empty() ) return rbands;
+    readSpectrum( sMasterSpectrum, tchannels, nBands, rbands.data() );
+    return rbands;
+}
+
+//--------------------------------------------------
+bool ofxMultiSpeakerSoundPlayer::readSpectrum( SpectrumAnalyzer& aAnalyzer, const std::vector<int>& achannels, int nBands, float* aOutBands ) {
+    for( int i = 0; i < nBands; i++ ) {
+        aOutBands[i] = 0.0f;
+    }
+    if( aAnalyzer.dsp == nullptr ) return false;
+    // the governor needs the cpu, the dsp comes back on the first read after it restores analysis //
+    if( sGovernorState.bAnalysisBypassed ) return false;
+
+    // someone is reading, so keep the dsp running //
+    aAnalyzer.idleUpdates = 0;
+    if( aAnalyzer.bBypassed ) {
+        OFX_MS_TRACE_FMOD( FMOD_DSP_SetBypass(aAnalyzer.dsp, false) );
+        aAnalyzer.bBypassed = false;
+    }
+
+    //  get the fft
+    //  useful info here: https://www.parallelcube.com/2018/03/10/frequency-spectrum-using-fmod-and-ue4/
+    FMOD_DSP_PARAMETER_FFT *fft = nullptr;
+    auto result = OFX_MS_TRACE_FMOD( FMOD_DSP_GetParameterData(aAnalyzer.dsp, FMOD_DSP_FFT_SPECTRUMDATA, (void **)&fft, 0, 0, 0) );
+    if( result != FMOD_OK || fft == nullptr ) return false;
+
+    // Only read / display half of the buffer typically for analysis
+    // as the 2nd half is usually the same data reversed due to the nature of the way FFT works. ( comment from link above )
+    int length = fft->length/2;
+    if( length < 1 ) return false;
+
+    std::vector <float> avgValCount;
+    avgValCount.assign(nBands, 0.0);
+
+    float normalizedBand = 0;
+    float normStep = 1.0 / (float)length;
+
+    for (int bin = 0; bin < length; bin++){
+        //should map 0 to nBands but accounting for lower frequency bands being more important
+        int logIndexBand = log10(1.0 + normalizedBand*9.0) * nBands;
+
+        if( achannels.empty() ) {
+            for (int channel = 0; channel < fft->numchannels; channel++){
+                aOutBands[logIndexBand] += fft->spectrum[channel][bin];
+                avgValCount[logIndexBand] += 1.0;
+            }
+        } else {
+            for( auto channel : achannels ) {
+                if( channel < 0 || channel >= fft->numchannels ) continue;
+                aOutBands[logIndexBand] += fft->spectrum[channel][bin];
+                avgValCount[logIndexBand] += 1.0;
+            }
+        }
+
+        normalizedBand += normStep;
+    }
+
+    for(int i = 0; i < nBands; i++){
+        //average the remapped bands based on how many times we added to each bin
+        if( avgValCount[i] > 1.0 ){
+            aOutBands[i] /= avgValCount[i];
+        }
+        // 	convert to db scale
+        aOutBands[i] = 10.0f * (float)log10(1 + aOutBands[i]) * 2.0f;
+    }
+    return true;
+}
+
+//--------------------------------------------------
+FMOD_DSP* ofxMultiSpeakerSoundPlayer::createSpectrumDSP( SpectrumAnalyzer& aAnalyzer ) {
+    if( aAnalyzer.dsp == nullptr ) {
+        if( OFX_MS_TRACE_FMOD( FMOD_System_CreateDSPByType(sys, FMOD_DSP_TYPE_FFT, &aAnalyzer.dsp) ) != FMOD_OK ) {
+            ofLogError("ofxMultiSpeakerSoundPlayer :: createSpectrumDSP : unable to create fft dsp");
+            aAnalyzer.dsp = nullptr;
+            return nullptr;
+        }
+        aAnalyzer.idleUpdates = 0;
+        aAnalyzer.bBypassed = false;
+        applySpectrumSettings( aAnalyzer );
+    }
+    return aAnalyzer.dsp;
+}
+
+//--------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::applySpectrumSettings( SpectrumAnalyzer& aAnalyzer ) {
+    // fmod only accepts power of 2 window sizes //
+    int tsize = 128;
+    while( tsize < aAnalyzer.settings.windowSize && tsize < 16384 ) {
+        tsize *= 2;
+    }
+    if( tsize != aAnalyzer.settings.windowSize ) {
+        ofLogWarning("ofxMultiSpeakerSoundPlayer :: applySpectrumSettings : window size ") << aAnalyzer.settings.windowSize << " is not supported, using " << tsize;
+        aAnalyzer.settings.windowSize = tsize;
+    }
+    if( aAnalyzer.dsp == nullptr ) return;
+    OFX_MS_TRACE_FMOD( FMOD_DSP_SetParameterInt(aAnalyzer.dsp, FMOD_DSP_FFT_WINDOWSIZE, aAnalyzer.settings.windowSize) );
+    OFX_MS_TRACE_FMOD( FMOD_DSP_SetParameterInt(aAnalyzer.dsp, FMOD_DSP_FFT_WINDOWTYPE, aAnalyzer.settings.windowType) );
+}
+
+//--------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::updateSpectrumAnalyzers() {
+    auto tickAnalyzer = []( SpectrumAnalyzer& aAnalyzer ) {
+        if( aAnalyzer.dsp == nullptr || aAnalyzer.bBypassed ) return;
+        if( aAnalyzer.settings.bypassAfterIdleUpdates < 1 ) return;
+        aAnalyzer.idleUpdates++;
+        if( aAnalyzer.idleUpdates >= aAnalyzer.settings.bypassAfterIdleUpdates ) {
+            // nobody is reading it, stop spending cpu on the fft //
+            OFX_MS_TRACE_FMOD( FMOD_DSP_SetBypass(aAnalyzer.dsp, true) );
+            aAnalyzer.bBypassed = true;
+        }
+    };
+    tickAnalyzer( sMasterSpectrum );
+    for( auto* analyzer : sSpectrumAnalyzers ) {
+        tickAnalyzer( *analyzer );
+    }
+}
+
+//--------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::releaseSpectrumAnalyzer( SpectrumAnalyzer& aAnalyzer ) {
+    if( aAnalyzer.dsp != nullptr ) {
+        if( bFmodInitialized_ ) {
+            // fmod refuses to release a dsp that is still attached //
+            FMOD_RESULT tresult = FMOD_OK;
+            if( aAnalyzer.attachedGroup != nullptr ) {
+                tresult = OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_RemoveDSP(aAnalyzer.attachedGroup, aAnalyzer.dsp) );
+            } else if( aAnalyzer.attachedChannel != nullptr ) {
+                tresult = OFX_MS_TRACE_FMOD( FMOD_Channel_RemoveDSP(aAnalyzer.attachedChannel, aAnalyzer.dsp) );
+                // a channel that has finished has already let go of its dsps //
+                if( tresult == FMOD_ERR_INVALID_HANDLE || tresult == FMOD_ERR_CHANNEL_STOLEN ) tresult = FMOD_OK;
+            }
+            if( tresult != FMOD_OK ) {
+                ofLogError("ofxMultiSpeakerSoundPlayer :: releaseSpectrumAnalyzer : unable to remove the fft dsp: ") << FMOD_ErrorString(tresult);
+            }
+            tresult = OFX_MS_TRACE_FMOD( FMOD_DSP_Release(aAnalyzer.dsp) );
+            if( tresult != FMOD_OK ) {
+                ofLogError("ofxMultiSpeakerSoundPlayer :: releaseSpectrumAnalyzer : unable to release the fft dsp: ") << FMOD_ErrorString(tresult);
+            }
+        }
+        aAnalyzer.dsp = nullptr;
+    }
+    aAnalyzer.attachedGroup = nullptr;
+    aAnalyzer.attachedChannel = nullptr;
+    aAnalyzer.idleUpdates = 0;
+    aAnalyzer.bBypassed = false;
+}
+
 // call this every frame //
 //--------------------
 void ofxMultiSpeakerSoundPlayer::updateSound() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::updateSound" );
+    commitBatch();
+    // before the fmod update, so the start delays are applied with it //
+    processCues();
 	fmodSoundUpdate();
+    updateGovernor();
+    updateSpectrumAnalyzers();
+    releaseRetiredWaveformBuilds( false );
+    applyPendingLoudness();
+    if( sSoftwareMixer != nullptr ) {
+        sSoftwareMixer->update();
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::updateGovernor() {
+    if( !sGovernorSettings.bEnabled || !bFmodInitialized_ ) return;
+
+    float tdsp = 0.0f, tstream = 0.0f, tgeometry = 0.0f, tupdate = 0.0f, ttotal = 0.0f;
+    if( OFX_MS_TRACE_FMOD( FMOD_System_GetCPUUsage(sys, &tdsp, &tstream, &tgeometry, &tupdate, &ttotal) ) == FMOD_OK ) {
+        float tsmoothing = ofClamp( sGovernorSettings.smoothing, 0.01f, 1.0f );
+        sGovernorState.cpuPercent += ( tdsp - sGovernorState.cpuPercent ) * tsmoothing;
+
+        if( sGovernorHoldUpdates > 0 ) {
+            sGovernorHoldUpdates--;
+        } else if( sGovernorState.cpuPercent > sGovernorSettings.ceilingPercent ) {
+            if( governorStepDown() ) sGovernorHoldUpdates = sGovernorSettings.holdUpdates;
+        } else if( sGovernorState.cpuPercent < sGovernorSettings.restorePercent && sGovernorState.level > 0 ) {
+            if( governorStepUp() ) sGovernorHoldUpdates = sGovernorSettings.holdUpdates;
+        }
+    }
+
+    // keep ranking while capped, and once more after the cap is lifted to unmute everyone //
+    int tmaxRealVoices = std::min(sFmodSettings.maxRealVoices, sFmodSettings.numChannels);
+    if( sGovernorState.realVoiceCap < tmaxRealVoices || sBGovernorCapActive ) {
+        applyGovernorVoiceCap();
+        sBGovernorCapActive = sGovernorState.realVoiceCap < tmaxRealVoices;
+    }
+}
+
+//--------------------
+bool ofxMultiSpeakerSoundPlayer::governorStepDown() {
+    // cheapest to give up first: analysis, then voices //
+    if( !sGovernorState.bAnalysisBypassed ) {
+        sGovernorState.bAnalysisBypassed = true;
+        auto tbypass = []( SpectrumAnalyzer& aAnalyzer ) {
+            if( aAnalyzer.dsp == nullptr || aAnalyzer.bBypassed ) return;
+            OFX_MS_TRACE_FMOD( FMOD_DSP_SetBypass(aAnalyzer.dsp, true) );
+            aAnalyzer.bBypassed = true;
+        };
+        tbypass( sMasterSpectrum );
+        for( auto* analyzer : sSpectrumAnalyzers ) {
+            tbypass( *analyzer );
+        }
+        sGovernorState.level++;
+        reportGovernorAdjustment( "bypassed the spectrum analysis dsps" );
+        return true;
+    }
+    // a muted voice is only skipped when fmod can make it virtual //
+    if( sFmodSettings.bVol0BecomesVirtual && sGovernorState.realVoiceCap > sGovernorSettings.minRealVoices ) {
+        float tfactor = ofClamp( sGovernorSettings.realVoiceCapFactor, 0.1f, 0.95f );
+        sGovernorState.realVoiceCap = std::max( sGovernorSettings.minRealVoices, (int)( sGovernorState.realVoiceCap * tfactor ) );
+        sGovernorState.level++;
+        reportGovernorAdjustment( "lowered the real voice cap to " + ofToString( sGovernorState.realVoiceCap ) );
+        return true;
+    }
+    return false;
+}
+
+//--------------------
+bool ofxMultiSpeakerSoundPlayer::governorStepUp() {
+    // undo the steps in reverse order //
+    int tmaxRealVoices = std::min(sFmodSettings.maxRealVoices, sFmodSettings.numChannels);
+    if( sGovernorState.realVoiceCap < tmaxRealVoices ) {
+        float tfactor = ofClamp( sGovernorSettings.realVoiceCapFactor, 0.1f, 0.95f );
+        sGovernorState.realVoiceCap = std::min( tmaxRealVoices, (int)ceilf( sGovernorState.realVoiceCap / tfactor ) );
+        sGovernorState.level = std::max( sGovernorState.level - 1, 0 );
+        reportGovernorAdjustment( "raised the real voice cap to " + ofToString( sGovernorState.realVoiceCap ) );
+        return true;
+    }
+    if( sGovernorState.bAnalysisBypassed ) {
+        // the analyzers un-bypass on their next read //
+        sGovernorState.bAnalysisBypassed = false;
+        sGovernorState.level = std::max( sGovernorState.level - 1, 0 );
+        reportGovernorAdjustment( "restored the spectrum analysis dsps" );
+        return true;
+    }
+    return false;
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::applyGovernorVoiceCap() {
+    // the most important and loudest voices keep playing, the rest are muted so fmod makes them virtual //
+    sGovernorRanked.clear();
+    for( auto* player : getPlayerList() ) {
+        if( player->isPlaying() && !player->bCulled ) {
+            sGovernorRanked.push_back( player );
+        } else if( player->bGovernorCulled ) {
+            player->bGovernorCulled = false;
+        }
+    }
+    std::sort( sGovernorRanked.begin(), sGovernorRanked.end(), []( ofxMultiSpeakerSoundPlayer* a, ofxMultiSpeakerSoundPlayer* b ) {
+        if( a->priority != b->priority ) return a->priority < b->priority;
+        return fabs(a->volume * a->normalizeGain) * a->maxSpeakerGain > fabs(b->volume * b->normalizeGain) * b->maxSpeakerGain;
+    });
+    for( int i = 0; i < (int)sGovernorRanked.size(); i++ ) {
+        auto* tplayer = sGovernorRanked[i];
+        bool bcull = i >= sGovernorState.realVoiceCap;
+        if( bcull != tplayer->bGovernorCulled ) {
+            tplayer->bGovernorCulled = bcull;
+            tplayer->applyVolume();
+            tplayer->mBackend->commit();
+        }
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::reportGovernorAdjustment( std::string adescription ) {
+    GovernorAdjustment tadjustment;
+    tadjustment.frameNum = ofGetFrameNum();
+    tadjustment.cpuPercent = sGovernorState.cpuPercent;
+    tadjustment.level = sGovernorState.level;
+    tadjustment.description = adescription;
+    ofLogNotice("ofxMultiSpeakerSoundPlayer :: governor : ") << adescription << " | dsp cpu: " << tadjustment.cpuPercent << "% level: " << tadjustment.level;
+    sGovernorAdjustments.push_back( tadjustment );
+    if( sGovernorAdjustments.size() > 100 ) {
+        sGovernorAdjustments.erase( sGovernorAdjustments.begin() );
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::beginBatch() {
+    sBBatching = true;
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::commitBatch() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::commitBatch" );
+    if( !sBBatching ) return;
+    sBBatching = false;
+    int tnumEntries = (int)sBatch.size();
+
+    // [1] gather the pans of every player that pans across its speakers //
+    sBatchRows.assign( tnumEntries, -1 );
+    sBatchPans.clear();
+    sBatchNumSpeakers.clear();
+    int tmaxSpeakers = 0;
+    for( int i = 0; i < tnumEntries; i++ ) {
+        auto* tplayer = sBatch[i].player;
+        if( tplayer == nullptr ) continue;
+        // like the unbatched setters, only playing channels are changed, the values are used when they start //
+        if( !tplayer->isPlaying() ) {
+            sBatch[i].flags = 0;
+            continue;
+        }
+        if( !(sBatch[i].flags & BATCH_PAN) ) continue;
+        if( !tplayer->isUsingSpeakerGains() || tplayer->isPanningToAllSpeakers() || tplayer->isUsingAmbisonics() ) continue;
+        sBatchRows[i] = (int)sBatchPans.size();
+        sBatchPans.push_back( ofMap( ofClamp(tplayer->pan, -1, 1), -1, 1, 0, 1, true ) );
+        sBatchNumSpeakers.push_back( (float)tplayer->mSpeakers.size() );
+        tmaxSpeakers = std::max( tmaxSpeakers, (int)tplayer->mSpeakers.size() );
+    }
+
+    // [2] all of the gains in one pass //
+    int tnumRows = (int)sBatchPans.size();
+    sBatchGains.resize( (size_t)tnumRows * tmaxSpeakers );
+    if( tnumRows > 0 ) {
+        computePanGainsBatch( sBatchPans.data(), sBatchNumSpeakers.data(), tnumRows, tmaxSpeakers, sBatchGains.data() );
+    }
+
+    // [3] one block of fmod calls //
+    float tvols[FMOD_SPEAKER_MAX];
+    for( int i = 0; i < tnumEntries; i++ ) {
+        auto* tplayer = sBatch[i].player;
+        if( tplayer == nullptr ) continue;
+        tplayer->mBatchIndex = -1;
+        if( sBatch[i].flags == 0 ) continue;
+        const float* tspeakerGains = nullptr;
+        int trow = sBatchRows[i];
+        if( trow > -1 ) {
+            std::fill( tvols, tvols + FMOD_SPEAKER_MAX, 0.0f );
+            for( int k = 0; k < (int)tplayer->mSpeakers.size(); k++ ) {
+                tvols[tplayer->mSpeakers[k]] = sBatchGains[(size_t)k * tnumRows + trow];
+            }
+            tspeakerGains = tvols;
+        }
+        tplayer->applyBatch( sBatch[i].flags, tspeakerGains );
+    }
+    sBatch.clear();
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::computePanGainsBatch( const float* apans, const float* anumSpeakers, int anum, int amaxSpeakers, float* aOut ) {
+    // same law as computeSpeakerGains, 1 - | slot / ( numSpeakers - 1 ) - pan |, zero past the player's speakers //
+    for( int k = 0; k < amaxSpeakers; k++ ) {
+        float tslot = (float)k;
+        float* tout = aOut + (size_t)k * anum;
+        int i = 0;
+#if defined(OFX_MULTI_SPEAKER_SSE)
+        __m128 vslot = _mm_set1_ps( tslot );
+        __m128 vone = _mm_set1_ps( 1.0f );
+        __m128 vzero = _mm_setzero_ps();
+        for( ; i + 4 <= anum; i += 4 ) {
+            __m128 vcount = _mm_loadu_ps( anumSpeakers + i );
+            __m128 vpct = _mm_div_ps( vslot, _mm_sub_ps( vcount, vone ) );
+            __m128 vdiff = _mm_sub_ps( vpct, _mm_loadu_ps( apans + i ) );
+            __m128 vgain = _mm_sub_ps( vone, _mm_max_ps( vdiff, _mm_sub_ps( vzero, vdiff ) ) );
+            _mm_storeu_ps( tout + i, _mm_and_ps( vgain, _mm_cmplt_ps( vslot, vcount ) ) );
+        }
+#elif defined(OFX_MULTI_SPEAKER_NEON)
+        float32x4_t vslot = vdupq_n_f32( tslot );
+        float32x4_t vone = vdupq_n_f32( 1.0f );
+        for( ; i + 4 <= anum; i += 4 ) {
+            float32x4_t vcount = vld1q_f32( anumSpeakers + i );
+            float32x4_t vden = vsubq_f32( vcount, vone );
+            // reciprocal estimate plus two newton steps, close enough to a divide for gains //
+            float32x4_t vinv = vrecpeq_f32( vden );
+            vinv = vmulq_f32( vinv, vrecpsq_f32( vden, vinv ) );
+            vinv = vmulq_f32( vinv, vrecpsq_f32( vden, vinv ) );
+            float32x4_t vgain = vsubq_f32( vone, vabsq_f32( vsubq_f32( vmulq_f32( vslot, vinv ), vld1q_f32( apans + i ) ) ) );
+            uint32x4_t vmask = vcltq_f32( vslot, vcount );
+            vst1q_f32( tout + i, vreinterpretq_f32_u32( vandq_u32( vreinterpretq_u32_f32( vgain ), vmask ) ) );
+        }
+#endif
+        for( ; i < anum; i++ ) {
+            tout[i] = tslot < anumSpeakers[i] ? 1.0f - fabs( tslot / ( anumSpeakers[i] - 1.0f ) - apans[i] ) : 0.0f;
+        }
+    }
+}
+
+//--------------------
+ofxMultiSpeakerSoundPlayer::VoiceStats ofxMultiSpeakerSoundPlayer::getVoiceStats() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::getVoiceStats" );
+    VoiceStats tstats;
+    if( !bFmodInitialized_ ) return tstats;
+    OFX_MS_TRACE_FMOD( FMOD_System_GetChannelsPlaying(sys, &tstats.numPlaying, &tstats.numReal) );
+    tstats.numVirtual = tstats.numPlaying - tstats.numReal;
+    for( auto* player : getPlayerList() ) {
+        if( player->bCulled && player->isPlaying() ) {
+            tstats.numCulled++;
+        } else if( player->bGovernorCulled && player->isPlaying() ) {
+            tstats.numCapped++;
+        }
+    }
+    return tstats;
+}
+
+//--------------------
+bool ofxMultiSpeakerSoundPlayer::trigger( const Cue& acue ) {
+    CueQueue& tqueue = getCueQueue();
+    const size_t tmask = CUE_QUEUE_SIZE - 1;
+    size_t tpos = tqueue.enqueuePos.load( std::memory_order_relaxed );
+    CueSlot* tslot = nullptr;
+    for( ;; ) {
+        tslot = &tqueue.slots[tpos & tmask];
+        size_t tsequence = tslot->sequence.load( std::memory_order_acquire );
+        intptr_t tdiff = (intptr_t)tsequence - (intptr_t)tpos;
+        if( tdiff == 0 ) {
+            // the slot is free, claim it //
+            if( tqueue.enqueuePos.compare_exchange_weak( tpos, tpos + 1, std::memory_order_relaxed ) ) break;
+        } else if( tdiff < 0 ) {
+            // the consumer has not freed this slot yet, the queue is full //
+            tqueue.numDropped.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+        } else {
+            tpos = tqueue.enqueuePos.load( std::memory_order_relaxed );
+        }
+    }
+    tslot->cue = acue;
+    if( tslot->cue.timestamp == 0 ) tslot->cue.timestamp = getCueTime();
+    tslot->sequence.store( tpos + 1, std::memory_order_release );
+    tqueue.numTriggered.fetch_add( 1, std::memory_order_relaxed );
+    return true;
+}
+
+//--------------------
+bool ofxMultiSpeakerSoundPlayer::trigger( uint32_t aplayerId, float again, float apan, float adelay ) {
+    Cue tcue;
+    tcue.playerId = aplayerId;
+    tcue.gain = again;
+    tcue.pan = apan;
+    tcue.delay = adelay;
+    return trigger( tcue );
+}
+
+//--------------------
+uint64_t ofxMultiSpeakerSoundPlayer::getCueTime() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+//--------------------
+ofxMultiSpeakerSoundPlayer::CueStats ofxMultiSpeakerSoundPlayer::getCueStats() {
+    CueQueue& tqueue = getCueQueue();
+    CueStats tstats;
+    tstats.numTriggered = tqueue.numTriggered.load();
+    tstats.numDropped = tqueue.numDropped.load();
+    tstats.numPlayed = tqueue.numPlayed;
+    tstats.numFailed = tqueue.numFailed;
+    tstats.numUnknownPlayer = tqueue.numUnknownPlayer;
+    tstats.numLate = tqueue.numLate;
+    return tstats;
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::processCues() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::processCues" );
+    CueQueue& tqueue = getCueQueue();
+    auto& tplayersById = getPlayersById();
+    const size_t tmask = CUE_QUEUE_SIZE - 1;
+    // the clocks are only read once there is something to start, and once per clock domain //
+    bool bHaveNow = false;
+    uint64_t tnow = 0;
+    struct ClockSnapshot {
+        const void* domain = nullptr;
+        unsigned long long clock = 0;
+        int rate = 0;
+    };
+    ClockSnapshot tclocks[4];
+    int tnumClocks = 0;
+
+    // at most one queue's worth, so producers that keep up with us can not hold the main thread here //
+    for( size_t n = 0; n < CUE_QUEUE_SIZE; n++ ) {
+        CueSlot& tslot = tqueue.slots[tqueue.dequeuePos & tmask];
+        if( tslot.sequence.load( std::memory_order_acquire ) != tqueue.dequeuePos + 1 ) break;
+        Cue tcue = tslot.cue;
+        tslot.sequence.store( tqueue.dequeuePos + CUE_QUEUE_SIZE, std::memory_order_release );
+        tqueue.dequeuePos++;
+
+        auto it = tplayersById.find( tcue.playerId );
+        if( it == tplayersById.end() || !it->second->bLoadedOk ) {
+            tqueue.numUnknownPlayer++;
+            continue;
+        }
+        ofxMultiSpeakerSoundPlayer* tplayer = it->second;
+
+        if( !bHaveNow ) {
+            tnow = getCueTime();
+            bHaveNow = true;
+        }
+        const void* tdomain = tplayer->mBackend->getClockDomain();
+        int tclockIndex = 0;
+        while( tclockIndex < tnumClocks && tclocks[tclockIndex].domain != tdomain ) tclockIndex++;
+        if( tclockIndex == tnumClocks ) {
+            tclockIndex = std::min( tnumClocks, 3 );
+            tclocks[tclockIndex].domain = tdomain;
+            tclocks[tclockIndex].clock = tplayer->mBackend->getClock();
+            tclocks[tclockIndex].rate = tplayer->mBackend->getClockRate();
+            tnumClocks = tclockIndex + 1;
+        }
+
+        // the cue's time relative to now, moved into the future by the latency //
+        double tseconds = (double)( (int64_t)tcue.timestamp - (int64_t)tnow ) * 1.0e-9 + (double)tcue.delay + (double)sCueSettings.latencySeconds;
+        if( tseconds < 0.0 ) {
+            tqueue.numLate++;
+            tseconds = 0.0;
+        }
+        unsigned long long tclock = tclocks[tclockIndex].clock + (unsigned long long)( tseconds * (double)tclocks[tclockIndex].rate );
+        if( tplayer->playCue( tcue, tclock ) ) {
+            tqueue.numPlayed++;
+        } else {
+            tqueue.numFailed++;
+        }
+    }
+}
+
+//--------------------
+bool ofxMultiSpeakerSoundPlayer::playCue( const Cue& acue, unsigned long long aclock ) {
+    volume = acue.gain;
+    pan = acue.pan;
+    if( bPrepared && isPlaying() ) {
+        // a prepared channel already has the old gains, a new one picks these up when it opens //
+        applyPan( nullptr );
+        applyVolume();
+    } else {
+        // every cue gets a channel of its own, so cues drained in the same update do not stop each other. //
+        // No fmod update here, updateSound() runs one after all of the cues //
+        bool tbMultiPlay = bMultiPlay;
+        bMultiPlay = true;
+        bool tbOpened = openChannel( true );
+        bMultiPlay = tbMultiPlay;
+        if( !tbOpened ) return false;
+    }
+    bPrepared = false;
+    mBackend->startAt( aclock );
+    return mBackend->commit();
 }
 
 //--------------------
 int ofxMultiSpeakerSoundPlayer::getNumberOfDrivers() {
 	if( !bFmodSysInited ) {
         bFmodSysInited=true;
-        FMOD_System_Create(&sys);
+        OFX_MS_TRACE_FMOD( FMOD_System_Create(&sys) );
     }
 	int numDrivers;
-	FMOD_System_GetNumDrivers(sys, &numDrivers);
+	OFX_MS_TRACE_FMOD( FMOD_System_GetNumDrivers(sys, &numDrivers) );
 	return numDrivers;
 }
 
@@ -273,6 +957,7 @@ void ofxMultiSpeakerSoundPlayer::printDriverList() {
 
 //--------------------
 vector<ofxMultiSpeakerSoundPlayer::Driver> ofxMultiSpeakerSoundPlayer::getDriverList() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::getDriverList" );
     int numDrivers = getNumberOfDrivers();
     vector<ofxMultiSpeakerSoundPlayer::Driver> rdrivers;
     for (int i = 0; i < numDrivers; i++) {
@@ -288,7 +973,7 @@ vector<ofxMultiSpeakerSoundPlayer::Driver> ofxMultiSpeakerSoundPlayer::getDriver
         //tdriver.name = sname;
         tdriver.index = i;
 
-        FMOD_System_GetDriverInfo(
+        OFX_MS_TRACE_FMOD( FMOD_System_GetDriverInfo(
             sys, 
             i, 
             name, 
@@ -297,7 +982,7 @@ vector<ofxMultiSpeakerSoundPlayer::Driver> ofxMultiSpeakerSoundPlayer::getDriver
             &tdriver.systemRate,
             &tdriver.speakerMode,
             &tdriver.speakerModeChannels
-        );
+        ) );
 
         string sname(name);
         //ofxMultiSpeakerSoundPlayer::Driver tdriver;
@@ -316,26 +1001,122 @@ vector<ofxMultiSpeakerSoundPlayer::Driver> ofxMultiSpeakerSoundPlayer::getDriver
 
 
 // now, the individual sound player:
+//------------------------------------------------------------
+std::vector<ofxMultiSpeakerSoundPlayer*>& ofxMultiSpeakerSoundPlayer::getPlayerList() {
+    static std::vector<ofxMultiSpeakerSoundPlayer*> sPlayers;
+    return sPlayers;
+}
+
 //------------------------------------------------------------
 ofxMultiSpeakerSoundPlayer::ofxMultiSpeakerSoundPlayer() {
     bLoop 			= false;
     bLoadedOk 		= false;
     pan 			= 0.0f; // range for oF is -1 to 1
     volume 			= 1.0f;
-    internalFreq 	= 44100;
     speed 			= 1;
     bPaused 		= false;
     isStreaming		= false;
+    mId = ++sNextPlayerId;
+    // built here, so trigger() never allocates it. A cue needs a player id anyway //
+    getCueQueue();
+    getPlayerList().push_back( this );
+    getPlayersById()[mId] = this;
 }
 
 //---------------------------------------
 ofxMultiSpeakerSoundPlayer::~ofxMultiSpeakerSoundPlayer() {
     unload();
+    if( mBatchIndex > -1 ) {
+        sBatch[mBatchIndex].player = nullptr;
+    }
+    auto& tplayers = getPlayerList();
+    auto pit = std::find( tplayers.begin(), tplayers.end(), this );
+    if( pit != tplayers.end() ) {
+        tplayers.erase( pit );
+    }
+    getPlayersById().erase( mId );
+    sSpectrumAnalyzers.erase( std::remove( sSpectrumAnalyzers.begin(), sSpectrumAnalyzers.end(), &mSpectrum ), sSpectrumAnalyzers.end() );
+    releaseSpectrumAnalyzer( mSpectrum );
+}
+
+//---------------------------------------
+ofxMultiSpeakerSoundPlayer::ofxMultiSpeakerSoundPlayer( ofxMultiSpeakerSoundPlayer&& aother ) : ofxMultiSpeakerSoundPlayer() {
+    *this = std::move( aother );
+}
+
+//---------------------------------------
+ofxMultiSpeakerSoundPlayer& ofxMultiSpeakerSoundPlayer::operator=( ofxMultiSpeakerSoundPlayer&& aother ) {
+    if( &aother == this ) return *this;
+    unload();
+    if( mBatchIndex > -1 ) {
+        sBatch[mBatchIndex].player = nullptr;
+        mBatchIndex = -1;
+    }
+    sSpectrumAnalyzers.erase( std::remove( sSpectrumAnalyzers.begin(), sSpectrumAnalyzers.end(), &mSpectrum ), sSpectrumAnalyzers.end() );
+    releaseSpectrumAnalyzer( mSpectrum );
+
+    isStreaming = aother.isStreaming;
+    bMultiPlay = aother.bMultiPlay;
+    bLoop = aother.bLoop;
+    bLoadedOk = aother.bLoadedOk;
+    bPaused = aother.bPaused;
+    bPrepared = aother.bPrepared;
+    pan = aother.pan;
+    volume = aother.volume;
+    normalizeGain = aother.normalizeGain;
+    mLoudnessPendingPath = std::move( aother.mLoudnessPendingPath );
+    mLoudnessTargetLUFS = aother.mLoudnessTargetLUFS;
+    mLoudnessMaxTruePeakDB = aother.mLoudnessMaxTruePeakDB;
+    maxSpeakerGain = aother.maxSpeakerGain;
+    priority = aother.priority;
+    bCulled = aother.bCulled;
+    bGovernorCulled = aother.bGovernorCulled;
+    speed = aother.speed;
+    length = aother.length;
+    mBPanToAllSpeakers = aother.mBPanToAllSpeakers;
+    bAmbisonic = aother.bAmbisonic;
+    azimuth = aother.azimuth;
+    elevation = aother.elevation;
+    mNumSoundChannels = aother.mNumSoundChannels;
+    result = aother.result;
+    currentLoaded = std::move( aother.currentLoaded );
+    mSpeakers = std::move( aother.mSpeakers );
+    mWaveformFuture = std::move( aother.mWaveformFuture );
+    mWaveform = std::move( aother.mWaveform );
+    mBackend = std::move( aother.mBackend );
+
+    // the fft dsp stays on the channel, only the analyzer that owns it moves //
+    mSpectrum = std::move( aother.mSpectrum );
+    aother.mSpectrum = SpectrumAnalyzer();
+    std::replace( sSpectrumAnalyzers.begin(), sSpectrumAnalyzers.end(), &aother.mSpectrum, &mSpectrum );
+
+    mBatchIndex = aother.mBatchIndex;
+    aother.mBatchIndex = -1;
+    if( mBatchIndex > -1 ) {
+        sBatch[mBatchIndex].player = this;
+    }
+
+    // cues sent to the id of aother reach the sound here now, cues for the old id of this are dropped //
+    // and aother starts over with a fresh id //
+    getPlayersById().erase( mId );
+    mId = aother.mId;
+    getPlayersById()[mId] = this;
+    aother.mId = ++sNextPlayerId;
+    getPlayersById()[aother.mId] = &aother;
+
+    aother.bLoadedOk = false;
+    aother.bPrepared = false;
+    aother.isStreaming = false;
+    aother.length = 0;
+    aother.normalizeGain = 1.0f;
+    aother.mLoudnessPendingPath = "";
+    return *this;
 }
 
 //---------------------------------------
 // this should only be called once
 void ofxMultiSpeakerSoundPlayer::initializeFmod() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::initializeFmod" );
 
     if(!bFmodInitialized_) {
         
@@ -365,7 +1146,7 @@ void ofxMultiSpeakerSoundPlayer::initializeFmod() {
         
         ofLogNotice("ofxMultiSpeakerSoundPlayer :: initializeFmod with device: ") << sFmodSettings.driverIndex << " | " << ofGetFrameNum();
         
-        FMOD_System_SetDriver(sys, sFmodSettings.driverIndex);
+        OFX_MS_TRACE_FMOD( FMOD_System_SetDriver(sys, sFmodSettings.driverIndex) );
         //FMOD_System_SetSpeakerMode(sys, FMOD_SPEAKERMODE_7POINT1);
 //		FMOD_System_SetSpeakerMode(sys, FMOD_SPEAKERMODE_5POINT1);
         //FMOD_RESULT FMOD_System_SetSpeakerMode(
@@ -382,25 +1163,53 @@ void ofxMultiSpeakerSoundPlayer::initializeFmod() {
         //    FMOD_SPEAKERMODE speakermode,
         //    int numrawspeakers
         //);
-        auto setSoftRes = FMOD_System_SetSoftwareFormat(
+        auto setSoftRes = OFX_MS_TRACE_FMOD( FMOD_System_SetSoftwareFormat(
             sys,
             sFmodSettings.sampleRate,
             sFmodSettings.speakerMode,
             0
-        );
+        ) );
         
         // set buffersize, keep number of buffers
         unsigned int bsTmp;
         int nbTmp;
-        FMOD_System_GetDSPBufferSize(sys, &bsTmp, &nbTmp);
-        FMOD_System_SetDSPBufferSize(sys, sFmodSettings.bufferSize, nbTmp);
+        OFX_MS_TRACE_FMOD( FMOD_System_GetDSPBufferSize(sys, &bsTmp, &nbTmp) );
+        OFX_MS_TRACE_FMOD( FMOD_System_SetDSPBufferSize(sys, sFmodSettings.bufferSize, nbTmp) );
 
 #ifdef TARGET_LINUX
-        FMOD_System_SetOutput(sys,FMOD_OUTPUTTYPE_ALSA);
+        OFX_MS_TRACE_FMOD( FMOD_System_SetOutput(sys,FMOD_OUTPUTTYPE_ALSA) );
 #endif
 
-        FMOD_System_Init(sys, sFmodSettings.numChannels, FMOD_INIT_NORMAL, NULL);  
-        FMOD_System_GetMasterChannelGroup(sys, &channelgroup);
+        // only maxRealVoices are mixed, the rest of numChannels are tracked as virtual voices //
+        OFX_MS_TRACE_FMOD( FMOD_System_SetSoftwareChannels(sys, std::min(sFmodSettings.maxRealVoices, sFmodSettings.numChannels)) );
+        FMOD_ADVANCEDSETTINGS tadvancedSettings;
+        memset( &tadvancedSettings, 0, sizeof(tadvancedSettings) );
+        tadvancedSettings.cbSize = sizeof(FMOD_ADVANCEDSETTINGS);
+        OFX_MS_TRACE_FMOD( FMOD_System_GetAdvancedSettings(sys, &tadvancedSettings) );
+        if( sFmodSettings.bVol0BecomesVirtual ) {
+            tadvancedSettings.vol0virtualvol = sFmodSettings.audibilityThreshold;
+        }
+        if( sFmodSettings.resamplerMethod == FMOD_DSP_RESAMPLER_DEFAULT ) {
+            sFmodSettings.resamplerMethod = FMOD_DSP_RESAMPLER_LINEAR;
+        }
+        tadvancedSettings.resamplerMethod = sFmodSettings.resamplerMethod;
+        if( sFmodSettings.maxMPEGCodecs > 0 ) tadvancedSettings.maxMPEGCodecs = sFmodSettings.maxMPEGCodecs;
+        if( sFmodSettings.maxADPCMCodecs > 0 ) tadvancedSettings.maxADPCMCodecs = sFmodSettings.maxADPCMCodecs;
+        if( sFmodSettings.maxVorbisCodecs > 0 ) tadvancedSettings.maxVorbisCodecs = sFmodSettings.maxVorbisCodecs;
+        if( sFmodSettings.maxPCMCodecs > 0 ) tadvancedSettings.maxPCMCodecs = sFmodSettings.maxPCMCodecs;
+        OFX_MS_TRACE_FMOD( FMOD_System_SetAdvancedSettings(sys, &tadvancedSettings) );
+        sGovernorState = GovernorState();
+        sGovernorState.realVoiceCap = std::min(sFmodSettings.maxRealVoices, sFmodSettings.numChannels);
+
+        FMOD_INITFLAGS tinitFlags = FMOD_INIT_NORMAL;
+        if( sFmodSettings.bVol0BecomesVirtual ) {
+            tinitFlags |= FMOD_INIT_VOL0_BECOMES_VIRTUAL;
+        }
+        OFX_MS_TRACE_FMOD( FMOD_System_Init(sys, sFmodSettings.numChannels, tinitFlags, NULL) );  
+        OFX_MS_TRACE_FMOD( FMOD_System_GetMasterChannelGroup(sys, &channelgroup) );
+#ifdef OFX_MULTI_SPEAKER_TRACE
+        ofxMultiSpeakerTrace::attachMixerTiming( sys );
+#endif
         bFmodInitialized_ = true;
     }
 }
@@ -408,12 +1217,109 @@ void ofxMultiSpeakerSoundPlayer::initializeFmod() {
 // should probably call this on exit()
 //---------------------------------------
 void ofxMultiSpeakerSoundPlayer::closeFmod() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::closeFmod" );
     if(bFmodInitialized_) {
-        FMOD_System_Close(sys);
+        // waveform workers still reading a sound need the system //
+        releaseRetiredWaveformBuilds( true );
+        // dsps are owned by the system, so release them before it goes away //
+        closeAmbisonicBus();
+        releaseSpectrumAnalyzer( sMasterSpectrum );
+        for( auto* analyzer : sSpectrumAnalyzers ) {
+            releaseSpectrumAnalyzer( *analyzer );
+        }
+        OFX_MS_TRACE_FMOD( FMOD_System_Close(sys) );
         bFmodInitialized_ = false;
     }
 }
 
+//---------------------------------------
+FMOD_SYSTEM* ofxMultiSpeakerSoundPlayer::getSystem() {
+    if( !bFmodInitialized_ ) return nullptr;
+    return sys;
+}
+
+//---------------------------------------
+FMOD_CHANNELGROUP* ofxMultiSpeakerSoundPlayer::getMasterChannelGroup() {
+    if( !bFmodInitialized_ ) return nullptr;
+    return channelgroup;
+}
+
+//---------------------------------------
+size_t ofxMultiSpeakerSoundPlayer::convertPCMToFloat( const void* adata, unsigned int anumBytes, FMOD_SOUND_FORMAT aformat, float* aOut ) {
+    size_t tnum = 0;
+    if( aformat == FMOD_SOUND_FORMAT_PCM8 ) {
+        const int8_t* tsrc = (const int8_t*)adata;
+        tnum = anumBytes;
+        for( size_t i = 0; i < tnum; i++ ) aOut[i] = (float)tsrc[i] / 128.0f;
+    } else if( aformat == FMOD_SOUND_FORMAT_PCM16 ) {
+        const int16_t* tsrc = (const int16_t*)adata;
+        tnum = anumBytes / 2;
+        for( size_t i = 0; i < tnum; i++ ) aOut[i] = (float)tsrc[i] / 32768.0f;
+    } else if( aformat == FMOD_SOUND_FORMAT_PCM24 ) {
+        const uint8_t* tsrc = (const uint8_t*)adata;
+        tnum = anumBytes / 3;
+        for( size_t i = 0; i < tnum; i++ ) {
+            int32_t tvalue = (int32_t)( ((uint32_t)tsrc[i*3] << 8) | ((uint32_t)tsrc[i*3+1] << 16) | ((uint32_t)tsrc[i*3+2] << 24) );
+            aOut[i] = (float)(tvalue >> 8) / 8388608.0f;
+        }
+    } else if( aformat == FMOD_SOUND_FORMAT_PCM32 ) {
+        const int32_t* tsrc = (const int32_t*)adata;
+        tnum = anumBytes / 4;
+        for( size_t i = 0; i < tnum; i++ ) aOut[i] = (float)((double)tsrc[i] / 2147483648.0);
+    } else if( aformat == FMOD_SOUND_FORMAT_PCMFLOAT ) {
+        tnum = anumBytes / 4;
+        memcpy( aOut, adata, tnum * sizeof(float) );
+    } else {
+        ofLogError("ofxMultiSpeakerSoundPlayer :: convertPCMToFloat : unsupported sound format: ") << aformat;
+    }
+    return tnum;
+}
+
+//---------------------------------------
+bool ofxMultiSpeakerSoundPlayer::loadPCMFloat( std::string aFilePath, std::vector<float>& aOutSamples, int& aOutNumChannels, float& aOutSampleRate, FMOD_SYSTEM* adecodeSystem ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::loadPCMFloat" );
+    aOutSamples.clear();
+    if( adecodeSystem == nullptr ) {
+        initializeFmod();
+        adecodeSystem = sys;
+    }
+
+    string tpath = ofToDataPath( aFilePath );
+    FMOD_SOUND* tsound = nullptr;
+    if( OFX_MS_TRACE_FMOD( FMOD_System_CreateSound(adecodeSystem, tpath.c_str(), FMOD_OPENONLY, NULL, &tsound) ) != FMOD_OK ) {
+        ofLogError("ofxMultiSpeakerSoundPlayer :: loadPCMFloat : could not open ") << tpath;
+        return false;
+    }
+
+    FMOD_SOUND_TYPE ttype;
+    FMOD_SOUND_FORMAT tformat;
+    int tbits = 0;
+    aOutNumChannels = 0;
+    aOutSampleRate = 0;
+    OFX_MS_TRACE_FMOD( FMOD_Sound_GetFormat(tsound, &ttype, &tformat, &aOutNumChannels, &tbits) );
+    OFX_MS_TRACE_FMOD( FMOD_Sound_GetDefaults(tsound, &aOutSampleRate, NULL) );
+
+    unsigned int tlengthBytes = 0;
+    OFX_MS_TRACE_FMOD( FMOD_Sound_GetLength(tsound, &tlengthBytes, FMOD_TIMEUNIT_PCMBYTES) );
+    if( tbits > 0 ) aOutSamples.reserve( tlengthBytes / (tbits/8) );
+
+    // multiple of 1, 2, 3 and 4 bytes so samples never straddle reads //
+    std::vector<char> tchunk( 49152 );
+    std::vector<float> tfloats( tchunk.size() );
+    while( true ) {
+        unsigned int tread = 0;
+        FMOD_RESULT tresult = OFX_MS_TRACE_FMOD( FMOD_Sound_ReadData(tsound, tchunk.data(), (unsigned int)tchunk.size(), &tread) );
+        if( tread > 0 ) {
+            size_t tnum = convertPCMToFloat( tchunk.data(), tread, tformat, tfloats.data() );
+            aOutSamples.insert( aOutSamples.end(), tfloats.begin(), tfloats.begin() + tnum );
+        }
+        if( tresult != FMOD_OK || tread == 0 ) break;
+    }
+    OFX_MS_TRACE_FMOD( FMOD_Sound_Release(tsound) );
+
+    return aOutNumChannels > 0 && aOutSamples.size() > 0;
+}
+
 //struct Settings {
 //    bool bLoops = false;
 //    SpeakerPair speakerPair = SPEAKERS_DEFAULT;
@@ -425,6 +1331,7 @@ void ofxMultiSpeakerSoundPlayer::closeFmod() {
 
 //------------------------------------------------------------
 bool ofxMultiSpeakerSoundPlayer::load( Settings asettings ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::load" );
     if( asettings.filePath == "" ) return false;
     bool bok = load( asettings.filePath, false );
     if( bok ) {
@@ -433,12 +1340,33 @@ bool ofxMultiSpeakerSoundPlayer::load( Settings asettings ) {
         setVolume( asettings.volume );
         setSpeakers( asettings.speakers );
         setPan( asettings.pan );
+        setDirection( asettings.azimuth, asettings.elevation );
+        setAmbisonic( asettings.bAmbisonic );
+        setPriority( asettings.priority );
+
+        float tnormalizeGain = 1.0f;
+        if( asettings.bNormalizeLoudness ) {
+            ofxMultiSpeakerLoudness::Result tloudness;
+            if( sLoudnessAnalyzer == nullptr ) {
+                ofLogWarning("ofxMultiSpeakerSoundPlayer :: load : bNormalizeLoudness is set, but there is no loudness analyzer, see setLoudnessAnalyzer()");
+            } else if( sLoudnessAnalyzer->analyze( asettings.filePath ) && sLoudnessAnalyzer->getResult( asettings.filePath, tloudness ) ) {
+                tnormalizeGain = ofxMultiSpeakerLoudness::getNormalizeGain( tloudness, asettings.normalizeTargetLUFS, asettings.normalizeMaxTruePeakDB );
+            } else {
+                ofLogNotice("ofxMultiSpeakerSoundPlayer :: load : no loudness analysis for ") << asettings.filePath << " yet, it has been queued";
+                // applyPendingLoudness() sets the gain once the worker is done //
+                mLoudnessPendingPath = asettings.filePath;
+                mLoudnessTargetLUFS = asettings.normalizeTargetLUFS;
+                mLoudnessMaxTruePeakDB = asettings.normalizeMaxTruePeakDB;
+            }
+        }
+        setNormalizeGain( tnormalizeGain );
     }
     return bLoadedOk;
 }
 
 //------------------------------------------------------------
 bool ofxMultiSpeakerSoundPlayer::load(const std::filesystem::path& fileName, bool stream) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::load" );
     string fileNameStr;
 	currentLoaded = fileName.string();
 
@@ -453,31 +1381,32 @@ bool ofxMultiSpeakerSoundPlayer::load(const std::filesystem::path& fileName, boo
 
     bMultiPlay = false;
 
-    // [1] init fmod, if necessary
-
-    initializeFmod();
-
-    // [2] try to unload any previously loaded sounds
+    // [1] try to unload any previously loaded sounds
     // & prevent user-created memory leaks
     // if they call "loadSound" repeatedly, for example
 
     unload();
 
-    // [3] load sound
+    // [2] pick the backend, init fmod if necessary
 
-    //choose if we want streaming
-    int fmodFlags =  FMOD_DEFAULT;
-    if(stream)fmodFlags =  FMOD_DEFAULT | FMOD_CREATESTREAM;
+    if( sSoftwareMixer != nullptr ) {
+        mBackend.reset( new ofxMultiSpeakerMixerBackend( sSoftwareMixer ) );
+    } else {
+        initializeFmod();
+        mBackend.reset( new ofxMultiSpeakerFmodBackend() );
+    }
 
-    result = FMOD_System_CreateSound(sys, fileNameStr.data(), fmodFlags, NULL, &sound);
+    // [3] load sound
 
-    if (result != FMOD_OK) {
+    if( !mBackend->load( fileNameStr, stream ) ) {
+        ofLogError("ofxMultiSpeakerSoundPlayer") << "loadSound(): could not load \"" << fileNameStr << "\"" << (isUsingSoftwareMixer() ? " into the software mixer" : "");
+        mBackend.reset();
         bLoadedOk = false;
-        ofLogError("ofxMultiSpeakerSoundPlayer") << "loadSound(): could not load \"" << fileNameStr << "\"";
     } else {
         bLoadedOk = true;
-        FMOD_Sound_GetLength(sound, &length, FMOD_TIMEUNIT_PCM);
-        isStreaming = stream;
+        length = mBackend->getLength();
+        mNumSoundChannels = mBackend->getNumChannels();
+        isStreaming = mBackend->isStreaming();
         
         if( sFmodSettings.speakers.size() > 0 ) {
             setSpeakers(sFmodSettings.speakers);
@@ -490,20 +1419,31 @@ bool ofxMultiSpeakerSoundPlayer::load(const std::filesystem::path& fileName, boo
 
 //------------------------------------------------------------
 void ofxMultiSpeakerSoundPlayer::unload() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::unload" );
+    mWaveform.reset();
     if (bLoadedOk) {
         stop();						// try to stop the sound
-        if(!isStreaming) FMOD_Sound_Release(sound);
         bLoadedOk = false;
     }
+    // the waveform worker may still be reading the sound, so the backend is released once it is done //
+    if( mWaveformFuture.valid() ) {
+        RetiredWaveformBuild tretired;
+        tretired.future = std::move( mWaveformFuture );
+        tretired.backend = std::move( mBackend );
+        sRetiredWaveformBuilds.push_back( std::move( tretired ) );
+    }
+    // releases the sound //
+    mBackend.reset();
+    // the loudness gain belongs to the file, load( Settings ) sets it again for the next one //
+    normalizeGain = 1.0f;
+    mLoudnessPendingPath = "";
 }
 
 //------------------------------------------------------------
 bool ofxMultiSpeakerSoundPlayer::isPlaying() const {
-    if (!bLoadedOk) return false;
-    if(channel == NULL) return false;
-    int playing = 0;
-    FMOD_Channel_IsPlaying(channel, &playing);
-    return (playing != 0 ? true : false);
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::isPlaying" );
+    if (!bLoadedOk || mBackend == nullptr) return false;
+    return mBackend->isPlaying();
 }
 
 //------------------------------------------------------------
@@ -527,26 +1467,75 @@ bool ofxMultiSpeakerSoundPlayer::isLoaded() const {
     return bLoadedOk;
 }
 
+//------------------------------------------------------------
+bool ofxMultiSpeakerSoundPlayer::isUsingSoftwareMixer() const {
+    return dynamic_cast<ofxMultiSpeakerMixerBackend*>( mBackend.get() ) != nullptr;
+}
+
 //------------------------------------------------------------
 void ofxMultiSpeakerSoundPlayer::setVolume(float vol) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setVolume" );
+    volume = vol;
+    if( addToBatch( BATCH_VOLUME ) ) return;
     if (isPlaying() == true) {
-        FMOD_Channel_SetVolume(channel, vol);
+        applyVolume();
+        mBackend->commit();
+    }
+}
+
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::applyVolume() {
+    // nothing can be heard in any speaker, a volume of 0 lets fmod make the voice virtual //
+    float tgain = volume * normalizeGain;
+    bCulled = sFmodSettings.bVol0BecomesVirtual && fabs(tgain) * maxSpeakerGain < sFmodSettings.audibilityThreshold;
+    if( bCulled || bGovernorCulled ) {
+        tgain = 0.0f;
+    }
+    mBackend->setVolume( tgain );
+}
+
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::setPriority( int apriority ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setPriority" );
+    priority = ofClamp( apriority, 0, 256 );
+    if (isPlaying() == true) {
+        mBackend->setPriority( priority );
+    }
+}
+
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::applyPendingLoudness() {
+    if( sLoudnessAnalyzer == nullptr ) return;
+    for( auto* tplayer : getPlayerList() ) {
+        if( tplayer->mLoudnessPendingPath == "" ) continue;
+        ofxMultiSpeakerLoudness::Result tloudness;
+        // a file that could not be analyzed has an invalid result, which keeps the gain at 1 //
+        if( !sLoudnessAnalyzer->getResult( tplayer->mLoudnessPendingPath, tloudness ) ) continue;
+        tplayer->mLoudnessPendingPath = "";
+        tplayer->setNormalizeGain( ofxMultiSpeakerLoudness::getNormalizeGain( tloudness, tplayer->mLoudnessTargetLUFS, tplayer->mLoudnessMaxTruePeakDB ) );
     }
-    volume = vol;
+}
+
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::setNormalizeGain( float again ) {
+    normalizeGain = again;
+    setVolume( volume );
 }
 
 //------------------------------------------------------------
 void ofxMultiSpeakerSoundPlayer::setPosition(float pct) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setPosition" );
     if (isPlaying() == true) {
         int sampleToBeAt = (int)(length * pct);
-        FMOD_Channel_SetPosition(channel, sampleToBeAt, FMOD_TIMEUNIT_PCM);
+        mBackend->setPosition( sampleToBeAt );
     }
 }
 
 //------------------------------------------------------------
 void ofxMultiSpeakerSoundPlayer::setPositionMS(int ms) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setPositionMS" );
     if (isPlaying() == true) {
-        FMOD_Channel_SetPosition(channel, ms, FMOD_TIMEUNIT_MS);
+        mBackend->setPositionMS( ms );
     }
 }
 
@@ -557,10 +1546,9 @@ void ofxMultiSpeakerSoundPlayer::setSpeakers( std::vector<FMOD_SPEAKER> aspeaker
 
 //------------------------------------------------------------
 float ofxMultiSpeakerSoundPlayer::getPosition() const {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::getPosition" );
     if (isPlaying() == true) {
-        unsigned int sampleImAt;
-
-        FMOD_Channel_GetPosition(channel, &sampleImAt, FMOD_TIMEUNIT_PCM);
+        unsigned int sampleImAt = mBackend->getPosition();
 
         float pct = 0.0f;
         if (length > 0) {
@@ -573,12 +1561,9 @@ float ofxMultiSpeakerSoundPlayer::getPosition() const {
 
 //------------------------------------------------------------
 int ofxMultiSpeakerSoundPlayer::getPositionMS() const {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::getPositionMS" );
     if (isPlaying() == true) {
-        unsigned int sampleImAt;
-
-        FMOD_Channel_GetPosition(channel, &sampleImAt, FMOD_TIMEUNIT_MS);
-
-        return sampleImAt;
+        return mBackend->getPositionMS();
     } else {
         return 0;
     }
@@ -586,111 +1571,530 @@ int ofxMultiSpeakerSoundPlayer::getPositionMS() const {
 
 //------------------------------------------------------------
 void ofxMultiSpeakerSoundPlayer::setPan(float p) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setPan" );
 
     pan = p;
-    p = ofClamp(p, -1, 1);
+    if( addToBatch( BATCH_PAN ) ) return;
 
-    if (channel == NULL) {
-        ofLogWarning("ofxMultiSpeakerSoundPlayer :: setPan : channel is NULL");
+    if (mBackend == nullptr) {
+        ofLogWarning("ofxMultiSpeakerSoundPlayer :: setPan : nothing loaded");
         return;
     }
 
     if (isPlaying() == true) {
-        if( mSpeakers.size() < 3 || sFmodSettings.speakerMode == FMOD_SPEAKERMODE_MONO || sFmodSettings.speakerMode == FMOD_SPEAKERMODE_STEREO ) {
-            FMOD_RESULT result = FMOD_Channel_SetPan(channel,p);
-            if (result != FMOD_OK) {
-                ofLogError("ofxMultiSpeakerSoundPlayer :: setPan : FMOD_Channel_SetPan - ERROR");
+        applyPan( nullptr );
+        applyVolume();
+        mBackend->commit();
+    }
+}
+
+// aspeakerGains are precomputed gains per FMOD_SPEAKER, computed here if nullptr //
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::applyPan( const float* aspeakerGains ) {
+    float p = ofClamp(pan, -1, 1);
+
+    if( isUsingAmbisonics() ) {
+        // rows are the acn channels of the bus, columns the channels of the file //
+        int torder = getAmbisonicOrder();
+        int tnumBusChannels = ofxMultiSpeakerAmbisonics::getNumChannels( torder );
+        int tnumChannels = ofClamp( mNumSoundChannels, 1, ofxMultiSpeakerMixer::MAX_CLIP_CHANNELS );
+        float tmatrix[ofxMultiSpeakerAmbisonics::MAX_CHANNELS * ofxMultiSpeakerMixer::MAX_CLIP_CHANNELS];
+        computeAmbisonicGains( torder, tnumChannels, tmatrix, tnumChannels );
+        mBackend->setAmbisonicGains( tmatrix, tnumBusChannels, tnumChannels );
+        // the omni channel is never above 1 //
+        maxSpeakerGain = 1.0f;
+        return;
+    }
+
+    if( !isUsingSpeakerGains() ) {
+        mBackend->setStereoPan( p );
+        maxSpeakerGain = 1.0f;
+    } else {
+        // linear map to play
+        vector<float> tvols;
+        if( aspeakerGains != nullptr ) {
+            tvols.assign( aspeakerGains, aspeakerGains + FMOD_SPEAKER_MAX );
+        } else {
+            computeSpeakerGains( p, tvols );
+        }
+
+        //FMOD_SPEAKER_NONE = -1,
+        //    FMOD_SPEAKER_FRONT_LEFT = 0,
+        //    FMOD_SPEAKER_FRONT_RIGHT,
+        //    FMOD_SPEAKER_FRONT_CENTER,
+        //    FMOD_SPEAKER_LOW_FREQUENCY,
+        //    FMOD_SPEAKER_SURROUND_LEFT,
+        //    FMOD_SPEAKER_SURROUND_RIGHT,
+        //    FMOD_SPEAKER_BACK_LEFT,
+        //    FMOD_SPEAKER_BACK_RIGHT,
+        //    FMOD_SPEAKER_TOP_FRONT_LEFT,
+        //    FMOD_SPEAKER_TOP_FRONT_RIGHT,
+        //    FMOD_SPEAKER_TOP_BACK_LEFT,
+        //    FMOD_SPEAKER_TOP_BACK_RIGHT,
+        mBackend->setSpeakerGains( tvols.data() );
+        // only the speakers the backend can reach count //
+        int tnumOutputs = ofClamp( mBackend->getNumOutputs(), 1, (int)FMOD_SPEAKER_MAX );
+        maxSpeakerGain = *std::max_element( tvols.begin(), tvols.begin() + tnumOutputs );
+    }
+}
+
+
+//------------------------------------------------------------
+bool ofxMultiSpeakerSoundPlayer::addToBatch( unsigned int aflags ) {
+    if( !sBBatching ) return false;
+    // a player is in the batch once, later changes only add flags and the latest values win //
+    if( mBatchIndex < 0 ) {
+        mBatchIndex = (int)sBatch.size();
+        BatchEntry tentry;
+        tentry.player = this;
+        sBatch.push_back( tentry );
+    }
+    sBatch[mBatchIndex].flags |= aflags;
+    return true;
+}
+
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::applyBatch( unsigned int aflags, const float* aspeakerGains ) {
+    if( mBackend == nullptr ) return;
+    if( aflags & BATCH_PAN ) applyPan( aspeakerGains );
+    if( aflags & BATCH_SPEED ) mBackend->setSpeed( speed );
+    if( aflags & (BATCH_VOLUME | BATCH_PAN) ) applyVolume();
+    // the software mixer publishes all of the voice parameters once //
+    mBackend->commit();
+}
+
+//------------------------------------------------------------
+bool ofxMultiSpeakerSoundPlayer::isUsingSpeakerGains() const {
+    // the backend knows how many speakers it reaches, the software mixer does not use the fmod speaker mode //
+    return mSpeakers.size() >= 3 && mBackend != nullptr && mBackend->getNumOutputs() > 2;
+}
+
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::computeSpeakerGains( float apan, std::vector<float>& aOutGains ) {
+    aOutGains.assign( FMOD_SPEAKER_MAX, 0.0f );
+    if (isPanningToAllSpeakers()) {
+        if (mSpeakers.size() > 0) {
+            float tgain = 1.f / (float)mSpeakers.size();
+            for (int i = 0; i < mSpeakers.size(); i++) {
+                aOutGains[mSpeakers[i]] = tgain;
             }
+        }
+    } else {
+        float p = ofMap(apan, -1, 1, 0, 1, true);
+        for (int i = 0; i < mSpeakers.size(); i++) {
+            float spct = (float)i / ((float)mSpeakers.size() - 1.f);
+            float sdiff = 1.0f - fabs(spct - p);
+            aOutGains[mSpeakers[i]] = sdiff;
+        }
+    }
+}
+
+//--------------------
+bool ofxMultiSpeakerSoundPlayer::setupAmbisonicBus( ofxMultiSpeakerAmbisonics::Settings asettings ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setupAmbisonicBus" );
+    closeAmbisonicBus();
+    initializeFmod();
+    if( !bFmodInitialized_ ) return false;
+
+    asettings.order = ofClamp( asettings.order, 1, ofxMultiSpeakerAmbisonics::MAX_ORDER );
+    int tnumBusChannels = ofxMultiSpeakerAmbisonics::getNumChannels( asettings.order );
+    FMOD_SPEAKERMODE tmode = FMOD_SPEAKERMODE_DEFAULT;
+    int tnumOutputChannels = 0;
+    OFX_MS_TRACE_FMOD( FMOD_System_GetSoftwareFormat(sys, NULL, &tmode, NULL) );
+    OFX_MS_TRACE_FMOD( FMOD_System_GetSpeakerModeChannels(sys, tmode, &tnumOutputChannels) );
+    if( asettings.speakers.empty() ) {
+        asettings.speakers = ofxMultiSpeakerAmbisonics::getDefaultSpeakers( tmode );
+    }
+    sAmbisonicBus.settings = asettings;
+    sAmbisonicBus.speakerMode = tmode;
+    sAmbisonicBus.numOutputChannels = tnumOutputChannels;
+    sAmbisonicBus.decoderGains = ofxMultiSpeakerAmbisonics::computeDecoder( asettings.speakers, asettings.order, asettings.bMaxRE, tnumOutputChannels );
+
+    FMOD_CHANNELGROUP* tgroup = nullptr;
+    FMOD_RESULT tresult = OFX_MS_TRACE_FMOD( FMOD_System_CreateChannelGroup(sys, "ofxMSAmbisonicBus", &tgroup) );
+    if( tresult == FMOD_OK ) {
+        tresult = OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_AddGroup(channelgroup, tgroup, true, NULL) );
+    }
+    if( tresult == FMOD_OK ) {
+        // the fader mixes the encoded channels as raw acn channels //
+        FMOD_DSP* tfader = nullptr;
+        OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_GetDSP(tgroup, FMOD_CHANNELCONTROL_DSP_TAIL, &tfader) );
+        tresult = OFX_MS_TRACE_FMOD( FMOD_DSP_SetChannelFormat(tfader, 0, tnumBusChannels, FMOD_SPEAKERMODE_RAW) );
+    }
+
+    FMOD_DSP* tdecoder = nullptr;
+    if( tresult == FMOD_OK ) {
+        FMOD_DSP_DESCRIPTION tdesc;
+        memset( &tdesc, 0, sizeof(tdesc) );
+        tdesc.pluginsdkversion = FMOD_PLUGIN_SDK_VERSION;
+        strncpy( tdesc.name, "ofxMSAmbisonicDecoder", sizeof(tdesc.name)-1 );
+        tdesc.version = 1;
+        tdesc.numinputbuffers = 1;
+        tdesc.numoutputbuffers = 1;
+        tdesc.process = &ofxMultiSpeakerSoundPlayer::ambisonicDecodeProcess;
+        tresult = OFX_MS_TRACE_FMOD( FMOD_System_CreateDSP(sys, &tdesc, &tdecoder) );
+    }
+    if( tresult == FMOD_OK ) {
+        OFX_MS_TRACE_FMOD( FMOD_DSP_SetChannelFormat(tdecoder, 0, tnumBusChannels, FMOD_SPEAKERMODE_RAW) );
+        tresult = OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_AddDSP(tgroup, FMOD_CHANNELCONTROL_DSP_HEAD, tdecoder) );
+    }
+    if( tresult != FMOD_OK ) {
+        ofLogError("ofxMultiSpeakerSoundPlayer :: setupAmbisonicBus : unable to create the bus: ") << FMOD_ErrorString(tresult);
+        if( tdecoder != nullptr ) OFX_MS_TRACE_FMOD( FMOD_DSP_Release(tdecoder) );
+        if( tgroup != nullptr ) OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_Release(tgroup) );
+        sAmbisonicBus = AmbisonicBus();
+        return false;
+    }
+    sAmbisonicBus.group = tgroup;
+    sAmbisonicBus.decoder = tdecoder;
+
+    for( auto* tplayer : getPlayerList() ) {
+        if( tplayer->bAmbisonic ) tplayer->routeChannel();
+    }
+    ofLogNotice("ofxMultiSpeakerSoundPlayer :: setupAmbisonicBus : order ") << asettings.order << ", " << tnumBusChannels << " bus channels decoded to " << tnumOutputChannels << " outputs";
+    return true;
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::closeAmbisonicBus() {
+    if( sAmbisonicBus.group == nullptr ) return;
+    FMOD_CHANNELGROUP* tgroup = sAmbisonicBus.group;
+    FMOD_DSP* tdecoder = sAmbisonicBus.decoder;
+    sAmbisonicBus.group = nullptr;
+    sAmbisonicBus.decoder = nullptr;
+
+    // back to the master group, panned between their speakers again //
+    for( auto* tplayer : getPlayerList() ) {
+        if( tplayer->bAmbisonic ) tplayer->routeChannel();
+    }
+    // removing the dsp takes the fmod dsp lock, so the mixer is no longer decoding after this //
+    OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_RemoveDSP(tgroup, tdecoder) );
+    OFX_MS_TRACE_FMOD( FMOD_DSP_Release(tdecoder) );
+    OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_Release(tgroup) );
+    sAmbisonicBus = AmbisonicBus();
+}
+
+// called from the fmod mixer thread //
+//--------------------
+FMOD_RESULT F_CALL ofxMultiSpeakerSoundPlayer::ambisonicDecodeProcess( FMOD_DSP_STATE*, unsigned int length, const FMOD_DSP_BUFFER_ARRAY* inbufferarray, FMOD_DSP_BUFFER_ARRAY* outbufferarray, FMOD_BOOL inputsidle, FMOD_DSP_PROCESS_OPERATION op ) {
+    if( op == FMOD_DSP_PROCESS_QUERY ) {
+        // acn channels in, the channels of the speaker mode out //
+        if( outbufferarray != nullptr ) {
+            outbufferarray->buffernumchannels[0] = sAmbisonicBus.numOutputChannels;
+            outbufferarray->bufferchannelmask[0] = 0;
+            outbufferarray->speakermode = sAmbisonicBus.speakerMode;
+        }
+        // nothing is playing on the bus //
+        if( inputsidle ) return FMOD_ERR_DSP_DONTPROCESS;
+        return FMOD_OK;
+    }
+    ofxMultiSpeakerAmbisonics::decode(
+        sAmbisonicBus.decoderGains,
+        inbufferarray->buffers[0], inbufferarray->buffernumchannels[0],
+        outbufferarray->buffers[0], outbufferarray->buffernumchannels[0],
+        (int)length
+    );
+    return FMOD_OK;
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::setAmbisonic( bool ab ) {
+    if( bAmbisonic == ab ) return;
+    bAmbisonic = ab;
+    routeChannel();
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::setDirection( float aazimuth, float aelevation ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setDirection" );
+    azimuth = aazimuth;
+    elevation = ofClamp( aelevation, -90, 90 );
+    if( !bAmbisonic ) return;
+    if( addToBatch( BATCH_PAN ) ) return;
+    if( isPlaying() ) {
+        applyPan( nullptr );
+        applyVolume();
+        mBackend->commit();
+    }
+}
+
+//--------------------
+bool ofxMultiSpeakerSoundPlayer::isUsingAmbisonics() const {
+    return bAmbisonic && getAmbisonicOrder() > 0;
+}
+
+//--------------------
+int ofxMultiSpeakerSoundPlayer::getAmbisonicOrder() const {
+    if( mBackend == nullptr ) return 0;
+    return mBackend->getAmbisonicOrder();
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::computeAmbisonicGains( int aorder, int anumChannels, float* aOut, int astride ) const {
+    // averaged like the speaker gains, so a stereo file is not louder than a mono one //
+    float tscale = 1.0f / (float)std::max( anumChannels, 1 );
+    float tharmonics[ofxMultiSpeakerAmbisonics::MAX_CHANNELS];
+    int tnumBusChannels = ofxMultiSpeakerAmbisonics::getNumChannels( aorder );
+    for( int c = 0; c < anumChannels; c++ ) {
+        // first channel on the left //
+        float tazimuth = azimuth;
+        if( anumChannels > 1 ) {
+            tazimuth += AMBISONIC_CHANNEL_SPREAD * ( 0.5f - (float)c / (float)(anumChannels - 1) );
+        }
+        ofxMultiSpeakerAmbisonics::encode( tazimuth, elevation, aorder, tharmonics );
+        for( int k = 0; k < tnumBusChannels; k++ ) {
+            aOut[k * astride + c] = tharmonics[k] * tscale;
+        }
+    }
+}
+
+//--------------------
+void ofxMultiSpeakerSoundPlayer::routeChannel() {
+    if( !isPlaying() ) return;
+    mBackend->setAmbisonic( isUsingAmbisonics() );
+    applyPan( nullptr );
+    applyVolume();
+    mBackend->commit();
+}
+
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::setSpectrumSettings( SpectrumSettings asettings ) {
+    mSpectrum.settings = asettings;
+    applySpectrumSettings( mSpectrum );
+}
+
+//------------------------------------------------------------
+const std::vector<float>& ofxMultiSpeakerSoundPlayer::getSpectrum( int nBands ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::getSpectrum" );
+    nBands = ofClamp( nBands, 1, 8192 );
+    mSpectrum.bands.assign( nBands, 0.0f );
+    // only fmod backends have a channel to analyse //
+    if( !bLoadedOk || mBackend->getSound() == nullptr ) return mSpectrum.bands;
+
+    if( mSpectrum.dsp == nullptr ) {
+        if( createSpectrumDSP( mSpectrum ) == nullptr ) {
+            return mSpectrum.bands;
+        }
+        // still listed when the dsp was released by closeFmod() //
+        if( std::find( sSpectrumAnalyzers.begin(), sSpectrumAnalyzers.end(), &mSpectrum ) == sSpectrumAnalyzers.end() ) {
+            sSpectrumAnalyzers.push_back( &mSpectrum );
+        }
+    }
+    attachSpectrumToChannel();
+    readSpectrum( mSpectrum, {}, nBands, mSpectrum.bands.data() );
+    return mSpectrum.bands;
+}
+
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::attachSpectrumToChannel() {
+    FMOD_CHANNEL* channel = mBackend != nullptr ? mBackend->getChannel() : nullptr;
+    if( mSpectrum.dsp == nullptr || channel == nullptr ) return;
+    if( mSpectrum.attachedChannel == channel ) return;
+    // the previous channel may already be gone, so ignore the result //
+    if( mSpectrum.attachedChannel != nullptr ) {
+        OFX_MS_TRACE_FMOD( FMOD_Channel_RemoveDSP(mSpectrum.attachedChannel, mSpectrum.dsp) );
+    }
+    if( OFX_MS_TRACE_FMOD( FMOD_Channel_AddDSP(channel, FMOD_CHANNELCONTROL_DSP_HEAD, mSpectrum.dsp) ) == FMOD_OK ) {
+        mSpectrum.attachedChannel = channel;
+    } else {
+        mSpectrum.attachedChannel = nullptr;
+    }
+}
+
+//------------------------------------------------------------
+bool ofxMultiSpeakerSoundPlayer::buildWaveform( WaveformSettings asettings ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::buildWaveform" );
+    if( !bLoadedOk ) {
+        ofLogWarning("ofxMultiSpeakerSoundPlayer :: buildWaveform : nothing loaded");
+        return false;
+    }
+    FMOD_SOUND* tsound = mBackend->getSound();
+    if( tsound == nullptr ) {
+        ofLogWarning("ofxMultiSpeakerSoundPlayer :: buildWaveform : not available with the software mixer");
+        return false;
+    }
+    if( mWaveformFuture.valid() ) {
+        ofLogWarning("ofxMultiSpeakerSoundPlayer :: buildWaveform : already building the waveform for ") << currentLoaded;
+        return false;
+    }
+    mWaveform.reset();
+    // streams are decoded from the file, samples are read straight from the loaded sound //
+    string tstreamPath = isStreaming ? ofToDataPath(currentLoaded) : "";
+    mWaveformFuture = std::async( std::launch::async, &ofxMultiSpeakerSoundPlayer::computeWaveform, isStreaming ? nullptr : tsound, tstreamPath, asettings );
+    return true;
+}
+
+//------------------------------------------------------------
+bool ofxMultiSpeakerSoundPlayer::isWaveformReady() {
+    if( mWaveformFuture.valid() && mWaveformFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready ) {
+        mWaveform = mWaveformFuture.get();
+        if( !mWaveform ) {
+            ofLogError("ofxMultiSpeakerSoundPlayer :: unable to build waveform for ") << currentLoaded;
+        }
+    }
+    return mWaveform != nullptr;
+}
+
+//------------------------------------------------------------
+std::shared_ptr<const ofxMultiSpeakerSoundPlayer::Waveform> ofxMultiSpeakerSoundPlayer::getWaveform() {
+    isWaveformReady();
+    return mWaveform;
+}
+
+//------------------------------------------------------------
+const ofxMultiSpeakerSoundPlayer::WaveformLevel* ofxMultiSpeakerSoundPlayer::getWaveformLevel( int asamplesPerBin ) {
+    if( !isWaveformReady() || mWaveform->levels.empty() ) return nullptr;
+    for( auto& tlevel : mWaveform->levels ) {
+        if( tlevel.samplesPerBin >= asamplesPerBin ) return &tlevel;
+    }
+    return &mWaveform->levels.back();
+}
+
+//------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::releaseRetiredWaveformBuilds( bool abWait ) {
+    for( auto it = sRetiredWaveformBuilds.begin(); it != sRetiredWaveformBuilds.end(); ) {
+        if( abWait || it->future.wait_for(std::chrono::seconds(0)) == std::future_status::ready ) {
+            // waits for the worker if it is still running, then releases the sound //
+            it = sRetiredWaveformBuilds.erase( it );
         } else {
-            // linear map to play
-//            FMOD_Channel_SetSpeakerMix(channel, 1.0, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-            /*
-            FMOD_RESULT Channel::setSpeakerMix(
-              float  frontleft,
-              float  frontright,
-              float  center,
-              float  lfe,
-              float  backleft,
-              float  backright,
-              float  sideleft,
-              float  sideright
-            );
-            */
-
-            //ChannelControl::setMixLevelsOutput
-            //    Sets the speaker volume levels for each speaker individually, this is a helper to avoid calling ChannelControl::setMixMatrix.
-
-            //FMOD_RESULT F_API FMOD_Channel_SetMixLevelsOutput (
-            //    FMOD_CHANNEL *channel, 
-            //    float frontleft, 
-            //    float frontright, 
-            //    float center, 
-            //    float lfe, --> Volume level for the subwoofer speaker.
-            //    float surroundleft, 
-            //    float surroundright, 
-            //    float backleft, 
-            //    float backright
-            //);
-
-            vector<float> tvols;
-            for( int i = 0; i < FMOD_SPEAKER_MAX; i++ ) {
-                tvols.push_back(0.0f);
+            ++it;
+        }
+    }
+}
+
+//------------------------------------------------------------
+std::shared_ptr<ofxMultiSpeakerSoundPlayer::Waveform> ofxMultiSpeakerSoundPlayer::computeWaveform( FMOD_SOUND* asound, std::string aStreamPath, WaveformSettings asettings ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::computeWaveform" );
+    FMOD_SOUND* tsound = asound;
+    if( aStreamPath != "" ) {
+        // a playing stream can not be read from, so open the file again just for decoding //
+        if( OFX_MS_TRACE_FMOD( FMOD_System_CreateSound(sys, aStreamPath.c_str(), FMOD_OPENONLY, NULL, &tsound) ) != FMOD_OK ) {
+            return nullptr;
+        }
+    }
+    if( tsound == nullptr ) return nullptr;
+
+    auto twave = std::make_shared<Waveform>();
+    FMOD_SOUND_TYPE ttype;
+    FMOD_SOUND_FORMAT tformat;
+    int tbits = 0;
+    OFX_MS_TRACE_FMOD( FMOD_Sound_GetFormat(tsound, &ttype, &tformat, &twave->numChannels, &tbits) );
+    OFX_MS_TRACE_FMOD( FMOD_Sound_GetDefaults(tsound, &twave->sampleRate, NULL) );
+    OFX_MS_TRACE_FMOD( FMOD_Sound_GetLength(tsound, &twave->numFrames, FMOD_TIMEUNIT_PCM) );
+
+    int tnumChannels = twave->numChannels;
+    int tframeBytes = (tbits / 8) * tnumChannels;
+    if( tnumChannels < 1 || tframeBytes < 1 ) {
+        if( aStreamPath != "" ) OFX_MS_TRACE_FMOD( FMOD_Sound_Release(tsound) );
+        return nullptr;
+    }
+
+    void* tlocked = nullptr;
+    void* tlocked2 = nullptr;
+    unsigned int tlockedBytes = 0;
+    unsigned int tlockedBytes2 = 0;
+    if( aStreamPath == "" ) {
+        if( OFX_MS_TRACE_FMOD( FMOD_Sound_Lock(tsound, 0, twave->numFrames * tframeBytes, &tlocked, &tlocked2, &tlockedBytes, &tlockedBytes2) ) != FMOD_OK ) {
+            return nullptr;
+        }
+        twave->numFrames = std::min( twave->numFrames, tlockedBytes / (unsigned int)tframeBytes );
+    }
+
+    WaveformLevel tbase;
+    tbase.samplesPerBin = std::max( asettings.baseSamplesPerBin, 1 );
+    tbase.numChannels = tnumChannels;
+    tbase.numBins = (int)((twave->numFrames + tbase.samplesPerBin - 1) / tbase.samplesPerBin);
+    tbase.mins.assign( (size_t)tbase.numBins * tnumChannels, 0.0f );
+    tbase.maxs.assign( (size_t)tbase.numBins * tnumChannels, 0.0f );
+    tbase.rms.assign( (size_t)tbase.numBins * tnumChannels, 0.0f );
+    tbase.lastBinSamples = (int)(twave->numFrames - (tbase.numBins > 0 ? (unsigned int)(tbase.numBins - 1) * tbase.samplesPerBin : 0));
+
+    // whole bins per chunk, so only the very last bin can be partial //
+    int tchunkFrames = tbase.samplesPerBin * std::max( 1, 65536 / tbase.samplesPerBin );
+    std::vector<char> traw( aStreamPath != "" ? (size_t)tchunkFrames * tframeBytes : 0 );
+    std::vector<float> tinterleaved( (size_t)tchunkFrames * tnumChannels );
+    std::vector<float> tplanar( tchunkFrames );
+
+    for( unsigned int tframe = 0; tframe < twave->numFrames; tframe += tchunkFrames ) {
+        int tnum = (int)std::min( (unsigned int)tchunkFrames, twave->numFrames - tframe );
+        if( aStreamPath == "" ) {
+            convertPCMToFloat( (const char*)tlocked + (size_t)tframe * tframeBytes, tnum * tframeBytes, tformat, tinterleaved.data() );
+        } else {
+            unsigned int tread = 0;
+            OFX_MS_TRACE_FMOD( FMOD_Sound_ReadData(tsound, traw.data(), tnum * tframeBytes, &tread) );
+            tnum = std::min( tnum, (int)(tread / tframeBytes) );
+            if( tnum < 1 ) break;
+            convertPCMToFloat( traw.data(), tnum * tframeBytes, tformat, tinterleaved.data() );
+        }
+
+        int tfirstBin = (int)(tframe / tbase.samplesPerBin);
+        for( int c = 0; c < tnumChannels; c++ ) {
+            for( int i = 0; i < tnum; i++ ) {
+                tplanar[i] = tinterleaved[(size_t)i * tnumChannels + c];
             }
-            if (isPanningToAllSpeakers()) {
-                if (mSpeakers.size() > 0) {
-                    p = 1.f / (float)mSpeakers.size();
-                    for (int i = 0; i < mSpeakers.size(); i++) {
-                        tvols[mSpeakers[i]] = p;
-                    }
-                }
-            } else {
-                p = ofMap(p, -1, 1, 0, 1, true);
-                for (int i = 0; i < mSpeakers.size(); i++) {
-                    float spct = (float)i / ((float)mSpeakers.size() - 1.f);
-                    float sdiff = 1.0f - fabs(spct - p);
-                    tvols[mSpeakers[i]] = sdiff;
-                }
+            for( int b = 0; b * tbase.samplesPerBin < tnum; b++ ) {
+                int tbinFrames = std::min( tbase.samplesPerBin, tnum - b * tbase.samplesPerBin );
+                float tmin, tmax, tsumSquares;
+                waveformReduce( &tplanar[b * tbase.samplesPerBin], tbinFrames, tmin, tmax, tsumSquares );
+                size_t tindex = (size_t)(tfirstBin + b) * tnumChannels + c;
+                tbase.mins[tindex] = tmin;
+                tbase.maxs[tindex] = tmax;
+                tbase.rms[tindex] = sqrtf( tsumSquares / (float)tbinFrames );
             }
+        }
+    }
 
-            //FMOD_SPEAKER_NONE = -1,
-            //    FMOD_SPEAKER_FRONT_LEFT = 0,
-            //    FMOD_SPEAKER_FRONT_RIGHT,
-            //    FMOD_SPEAKER_FRONT_CENTER,
-            //    FMOD_SPEAKER_LOW_FREQUENCY,
-            //    FMOD_SPEAKER_SURROUND_LEFT,
-            //    FMOD_SPEAKER_SURROUND_RIGHT,
-            //    FMOD_SPEAKER_BACK_LEFT,
-            //    FMOD_SPEAKER_BACK_RIGHT,
-            //    FMOD_SPEAKER_TOP_FRONT_LEFT,
-            //    FMOD_SPEAKER_TOP_FRONT_RIGHT,
-            //    FMOD_SPEAKER_TOP_BACK_LEFT,
-            //    FMOD_SPEAKER_TOP_BACK_RIGHT,
-
-            //FMOD_Channel_SetSpeakerMix(channel, tvols[0], tvols[1], tvols[2], tvols[3], tvols[4], tvols[5], tvols[6], tvols[7] );
-            FMOD_RESULT result = FMOD_Channel_SetMixLevelsOutput(
-                channel, 
-                tvols[0], 
-                tvols[1], 
-                tvols[2], 
-                tvols[3], 
-                tvols[4], 
-                tvols[5], 
-                tvols[6], 
-                tvols[7]
-            );
-
-            if (result != FMOD_OK) {
-                ofLogError("ofxMultiSpeakerSoundPlayer :: setPan : FMOD_Channel_SetMixLevelsOutput - ERROR");
+    if( aStreamPath == "" ) {
+        OFX_MS_TRACE_FMOD( FMOD_Sound_Unlock(tsound, tlocked, tlocked2, tlockedBytes, tlockedBytes2) );
+    } else {
+        OFX_MS_TRACE_FMOD( FMOD_Sound_Release(tsound) );
+    }
+    twave->levels.push_back( tbase );
+
+    // every level above merges pairs of bins from the one below //
+    while( twave->levels.back().numBins > 1 && (asettings.numLevels < 1 || (int)twave->levels.size() < asettings.numLevels) ) {
+        const WaveformLevel& tprev = twave->levels.back();
+        WaveformLevel tnext;
+        tnext.samplesPerBin = tprev.samplesPerBin * 2;
+        tnext.numChannels = tnumChannels;
+        tnext.numBins = (tprev.numBins + 1) / 2;
+        tnext.mins.resize( (size_t)tnext.numBins * tnumChannels );
+        tnext.maxs.resize( (size_t)tnext.numBins * tnumChannels );
+        tnext.rms.resize( (size_t)tnext.numBins * tnumChannels );
+        for( int b = 0; b < tnext.numBins; b++ ) {
+            int ta = b * 2;
+            int tb = ta + 1;
+            float tna = (float)(ta == tprev.numBins - 1 ? tprev.lastBinSamples : tprev.samplesPerBin);
+            float tnb = tb < tprev.numBins ? (float)(tb == tprev.numBins - 1 ? tprev.lastBinSamples : tprev.samplesPerBin) : 0.0f;
+            for( int c = 0; c < tnumChannels; c++ ) {
+                size_t tia = (size_t)ta * tnumChannels + c;
+                size_t tib = (size_t)tb * tnumChannels + c;
+                size_t tindex = (size_t)b * tnumChannels + c;
+                if( tnb > 0.0f ) {
+                    tnext.mins[tindex] = std::min( tprev.mins[tia], tprev.mins[tib] );
+                    tnext.maxs[tindex] = std::max( tprev.maxs[tia], tprev.maxs[tib] );
+                    tnext.rms[tindex] = sqrtf( (tprev.rms[tia] * tprev.rms[tia] * tna + tprev.rms[tib] * tprev.rms[tib] * tnb) / (tna + tnb) );
+                } else {
+                    tnext.mins[tindex] = tprev.mins[tia];
+                    tnext.maxs[tindex] = tprev.maxs[tia];
+                    tnext.rms[tindex] = tprev.rms[tia];
+                }
+            }
+            if( b == tnext.numBins - 1 ) {
+                tnext.lastBinSamples = (int)(tna + tnb);
             }
         }
+        twave->levels.push_back( tnext );
     }
+    return twave;
 }
 
-
 //------------------------------------------------------------
 void ofxMultiSpeakerSoundPlayer::setPaused(bool bP) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setPaused" );
     if (isPlaying() == true) {
-        FMOD_Channel_SetPaused(channel,bP);
+        mBackend->setPaused( bP );
+        mBackend->commit();
         bPaused = bP;
     }
 }
@@ -698,17 +2102,22 @@ void ofxMultiSpeakerSoundPlayer::setPaused(bool bP) {
 
 //------------------------------------------------------------
 void ofxMultiSpeakerSoundPlayer::setSpeed(float spd) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setSpeed" );
+    speed = spd;
+    if( addToBatch( BATCH_SPEED ) ) return;
     if (isPlaying() == true) {
-        FMOD_Channel_SetFrequency(channel, internalFreq * spd);
+        mBackend->setSpeed( spd );
+        mBackend->commit();
     }
-    speed = spd;
 }
 
 
 //------------------------------------------------------------
 void ofxMultiSpeakerSoundPlayer::setLoop(bool bLp) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::setLoop" );
     if (isPlaying() == true) {
-        FMOD_Channel_SetMode(channel,  (bLp == true) ? FMOD_LOOP_NORMAL : FMOD_LOOP_OFF);
+        mBackend->setLoop( bLp );
+        mBackend->commit();
     }
     bLoop = bLp;
 }
@@ -719,34 +2128,108 @@ void ofxMultiSpeakerSoundPlayer::setMultiPlay(bool bMp) {
 }
 
 // ----------------------------------------------------------------------------
-void ofxMultiSpeakerSoundPlayer::play() {
+bool ofxMultiSpeakerSoundPlayer::openChannel( bool abPaused ) {
+    if( mBackend == nullptr ) return false;
 
     // if it's a looping sound, we should try to kill it, no?
     // or else people will have orphan channels that are looping
-    if (bLoop == true) {
-        FMOD_Channel_Stop(channel);
-    }
-
     // if the sound is not set to multiplay, then stop the current,
     // before we start another
-    if (!bMultiPlay) {
-        FMOD_Channel_Stop(channel);
+    bool bstopPrevious = bLoop == true || !bMultiPlay;
+    bPrepared = false;
+
+    // always start paused, so every parameter is in place before the first mix block //
+    if( !mBackend->open( bstopPrevious, isUsingAmbisonics() ) ) {
+        ofLogError("ofxMultiSpeakerSoundPlayer :: unable to play ") << currentLoaded;
+        return false;
     }
 
-    FMOD_System_PlaySound(sys, sound, channelgroup, bPaused, &channel);
+    mBackend->setPriority( priority );
+    applyPan( nullptr );
+    applyVolume();
+    mBackend->setSpeed( speed );
+    mBackend->setLoop( bLoop );
+    // keep analysing the new channel if someone has asked for the spectrum //
+    attachSpectrumToChannel();
 
-    FMOD_Channel_GetFrequency(channel, &internalFreq);
-    FMOD_Channel_SetVolume(channel,volume);
-    setPan(pan);
-    FMOD_Channel_SetFrequency(channel, internalFreq * speed);
-    FMOD_Channel_SetMode(channel, (bLoop == true) ? FMOD_LOOP_NORMAL : FMOD_LOOP_OFF);
+    if( !abPaused ) {
+        mBackend->setPaused( false );
+    }
+    // the software mixer starts the voice here, fully described //
+    if( !mBackend->commit() ) {
+        ofLogError("ofxMultiSpeakerSoundPlayer :: unable to play ") << currentLoaded << ", no free voice";
+        return false;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::play() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::play" );
+
+    // the channel is already set up, starting it is only an unpause //
+    if( bPrepared && isPlaying() ) {
+        bPrepared = false;
+        if( !bPaused ) {
+            mBackend->setPaused( false );
+            mBackend->commit();
+        }
+        return;
+    }
+
+    if( !openChannel( bPaused ) ) return;
 
     //fmod update() should be called every frame - according to the docs.
     //we have been using fmod without calling it at all which resulted in channels not being able
     //to be reused.  we should have some sort of global update function but putting it here
     //solves the channel bug
-    FMOD_System_Update(sys);
+    mBackend->update();
+
+}
 
+// ----------------------------------------------------------------------------
+bool ofxMultiSpeakerSoundPlayer::prepare() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::prepare" );
+    if( !bLoadedOk ) {
+        ofLogWarning("ofxMultiSpeakerSoundPlayer :: prepare : nothing loaded");
+        return false;
+    }
+    // opening the channel fills the stream buffers, so the cost is paid here instead of in play() //
+    if( !openChannel( true ) ) {
+        return false;
+    }
+    bPrepared = true;
+    mBackend->update();
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+bool ofxMultiSpeakerSoundPlayer::isPrepared() const {
+    if( !bPrepared || !isPlaying() ) return false;
+    return mBackend->isReady();
+}
+
+// ----------------------------------------------------------------------------
+void ofxMultiSpeakerSoundPlayer::playAtDSPClock( unsigned long long aclock ) {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::playAtDSPClock" );
+    if( !bPrepared || !isPlaying() ) {
+        if( !prepare() ) return;
+    }
+    bPrepared = false;
+    mBackend->startAt( aclock );
+    mBackend->commit();
+}
+
+// ----------------------------------------------------------------------------
+unsigned long long ofxMultiSpeakerSoundPlayer::getDSPClock() {
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::getDSPClock" );
+    if( sSoftwareMixer != nullptr ) {
+        return sSoftwareMixer->getClock();
+    }
+    initializeFmod();
+    unsigned long long tclock = 0;
+    OFX_MS_TRACE_FMOD( FMOD_ChannelGroup_GetDSPClock(channelgroup, &tclock, NULL) );
+    return tclock;
 }
 //
 //// ----------------------------------------------------------------------------
@@ -821,5 +2304,9 @@ void ofxMultiSpeakerSoundPlayer::play() {
 
 // ----------------------------------------------------------------------------
 void ofxMultiSpeakerSoundPlayer::stop() {
-    FMOD_Channel_Stop(channel);
+    OFX_MS_TRACE_SCOPE( "ofxMultiSpeakerSoundPlayer::stop" );
+    if( mBackend != nullptr ) {
+        mBackend->stop();
+    }
+    bPrepared = false;
 }
@@ -7,6 +7,12 @@
 #include "ofLog.h"
 
 #include "ofSoundBaseTypes.h"
+#include "ofxMultiSpeakerMixer.h"
+#include "ofxMultiSpeakerAmbisonics.h"
+#include "ofxMultiSpeakerPlayerBackend.h"
+
+#include <future>
+#include <memory>
 
 extern "C" {
 #include "fmod.h"
@@ -18,6 +24,8 @@ extern "C" {
 #define OFX_MULTI_SPEAKER_PLAYER
 #endif
 
+class ofxMultiSpeakerLoudness;
+
 
 class ofxMultiSpeakerSoundPlayer : public ofBaseSoundPlayer {
 public:
@@ -41,13 +49,107 @@ public:
     struct FmodSettings {
         FMOD_SPEAKERMODE speakerMode = FMOD_SPEAKERMODE_STEREO;
         int driverIndex = 0;
+        // total voices, real and virtual //
         int numChannels = 64;
         std::string driverName = "";
         unsigned int bufferSize = 1024;
         std::vector<FMOD_SPEAKER> speakers;
         int sampleRate = 44100;
+        // voices that are actually mixed, the least audible / lowest priority voices beyond this go virtual //
+        int maxRealVoices = 64;
+        // opt in, voices under audibilityThreshold are made virtual and cost almost nothing //
+        bool bVol0BecomesVirtual = false;
+        // linear gain, volume times the loudest speaker gain from setPan, only used with bVol0BecomesVirtual //
+        // 0 keeps fmod's default where only silent voices go virtual, 0.001 is about -60dB //
+        float audibilityThreshold = 0.0f;
+        // resampler for every channel, fmod only reads it in initializeFmod //
+        FMOD_DSP_RESAMPLER resamplerMethod = FMOD_DSP_RESAMPLER_LINEAR;
+        // decoders for compressed sounds created with FMOD_CREATECOMPRESSEDSAMPLE, 0 = fmod default //
+        int maxMPEGCodecs = 0;
+        int maxADPCMCodecs = 0;
+        int maxVorbisCodecs = 0;
+        int maxPCMCodecs = 0;
+    };
+    
+    // steps quality down when the fmod mixer gets close to running out of time, see setGovernorSettings //
+    struct GovernorSettings {
+        bool bEnabled = false;
+        // dsp cpu percent from FMOD_System_GetCPUUsage where the governor steps down //
+        float ceilingPercent = 75.0f;
+        // the load has to fall under this before a step is undone //
+        float restorePercent = 50.0f;
+        // calls to updateSound() between adjustments, so the load can settle //
+        int holdUpdates = 30;
+        // smoothing of the sampled load, 0 - 1, higher follows faster //
+        float smoothing = 0.2f;
+        // the real voice cap is not lowered under this //
+        int minRealVoices = 16;
+        // each step multiplies the real voice cap by this //
+        float realVoiceCapFactor = 0.75f;
+    };
+    
+    struct GovernorState {
+        // smoothed dsp cpu percent //
+        float cpuPercent = 0.0f;
+        // steps below full quality //
+        int level = 0;
+        bool bAnalysisBypassed = false;
+        int realVoiceCap = 0;
+    };
+    
+    struct GovernorAdjustment {
+        uint64_t frameNum = 0;
+        float cpuPercent = 0.0f;
+        // level after the adjustment //
+        int level = 0;
+        std::string description = "";
+    };
+    
+    struct VoiceStats {
+        int numPlaying = 0;
+        int numReal = 0;
+        int numVirtual = 0;
+        // players muted because their gain in every speaker was under audibilityThreshold //
+        int numCulled = 0;
+        // players muted by the governor's real voice cap //
+        int numCapped = 0;
+    };
+    
+    // a request to start a player, see trigger() //
+    struct Cue {
+        // getId() of the player //
+        uint32_t playerId = 0;
+        // replaces the player's volume and pan, pan is ignored by ambisonic players //
+        float gain = 1.0f;
+        float pan = 0.0f;
+        // seconds after the timestamp //
+        float delay = 0.0f;
+        // getCueTime() when the event happened, 0 = when trigger() is called //
+        uint64_t timestamp = 0;
+    };
+    
+    struct CueSettings {
+        // added to every cue, so cues keep their spacing when they are drained together. //
+        // Should cover the time between calls to updateSound() //
+        float latencySeconds = 0.05f;
     };
     
+    struct CueStats {
+        uint64_t numTriggered = 0;
+        uint64_t numPlayed = 0;
+        // trigger() returned false because the queue was full //
+        uint64_t numDropped = 0;
+        // the player id was unknown or nothing was loaded, ie. the player was destroyed //
+        uint64_t numUnknownPlayer = 0;
+        // drained after the time they should have started, started right away //
+        uint64_t numLate = 0;
+        // the player could not open a channel or voice for the cue //
+        uint64_t numFailed = 0;
+    };
+    
+    // cues that can wait in the queue, power of 2 //
+    static const size_t CUE_QUEUE_SIZE = 16384;
+    
     struct Settings {
         bool bLoops = false;
 //        SpeakerPair speakerPair = SPEAKERS_DEFAULT;
@@ -57,10 +159,66 @@ public:
         float volume = 1.0f;
         // array of speakers to pan between
         std::vector<FMOD_SPEAKER> speakers;
+        // scale the volume so the file plays at normalizeTargetLUFS, needs a loudness analyzer, see setLoudnessAnalyzer //
+        // a file that has not been analyzed yet plays at gain 1 until updateSound() picks up its result //
+        bool bNormalizeLoudness = false;
+        float normalizeTargetLUFS = -23.0f;
+        float normalizeMaxTruePeakDB = -1.0f;
+        // 0 = most important, 256 = least important, lower priority voices go virtual first //
+        int priority = 128;
+        // encode into the ambisonic bus at azimuth / elevation in degrees instead of panning, see setupAmbisonicBus //
+        bool bAmbisonic = false;
+        float azimuth = 0.0f;
+        float elevation = 0.0f;
+    };
+    
+    struct SpectrumSettings {
+        // fft window size in samples, power of 2 between 128 and 16384 //
+        int windowSize = 2048;
+        FMOD_DSP_FFT_WINDOW windowType = FMOD_DSP_FFT_WINDOW_HANNING;
+        // bypass the fft dsp when it has not been read for this many calls to updateSound(), 0 = never bypass //
+        int bypassAfterIdleUpdates = 30;
+    };
+    
+    // fft dsp attached to a player channel or the master group, created on the first read //
+    struct SpectrumAnalyzer {
+        FMOD_DSP* dsp = nullptr;
+        FMOD_CHANNELGROUP* attachedGroup = nullptr;
+        FMOD_CHANNEL* attachedChannel = nullptr;
+        SpectrumSettings settings;
+        int idleUpdates = 0;
+        bool bBypassed = false;
+        std::vector<float> bands;
+    };
+    
+    struct WaveformSettings {
+        // frames per bin in the most detailed level //
+        int baseSamplesPerBin = 256;
+        // number of levels, each one halves the bins of the one before, 0 = keep halving down to one bin //
+        int numLevels = 0;
+    };
+    
+    // min, max and rms per bin and channel, stored as [ bin * numChannels + channel ] //
+    struct WaveformLevel {
+        int samplesPerBin = 0;
+        int numBins = 0;
+        int numChannels = 0;
+        std::vector<float> mins;
+        std::vector<float> maxs;
+        std::vector<float> rms;
+        // frames in the last bin, which can be partial //
+        int lastBinSamples = 0;
+    };
+    
+    struct Waveform {
+        int numChannels = 0;
+        float sampleRate = 0;
+        unsigned int numFrames = 0;
+        std::vector<WaveformLevel> levels;
     };
     
     static bool setFmodSettings( FmodSettings aFmodSettings );
-    static FmodSettings getFmodSettings() { return sFmodSettings; }
+    static const FmodSettings& getFmodSettings() { return sFmodSettings; }
 
 	static std::string getSpeakerName(FMOD_SPEAKER aspeaker);
 	static FMOD_SPEAKER getSpeakerForName(std::string aname);
@@ -68,11 +226,66 @@ public:
 	static std::string getSpeakerModeName(FMOD_SPEAKERMODE amode);
 	static FMOD_SPEAKERMODE getSpeakerModeForName(std::string aname);
     static std::vector<std::string> getSpeakerNameList();
+    // channel of the speaker in the output mix of amode, -1 if the mode has no such speaker //
+    static int getSpeakerChannel( FMOD_SPEAKER aspeaker, FMOD_SPEAKERMODE amode );
+    
+    // analyzer used by load( Settings ) when bNormalizeLoudness is set //
+    static void setLoudnessAnalyzer( ofxMultiSpeakerLoudness* aanalyzer ) { sLoudnessAnalyzer = aanalyzer; }
+    static ofxMultiSpeakerLoudness* getLoudnessAnalyzer() { return sLoudnessAnalyzer; }
+    
+    // players loaded after this is set play through the software mixer instead of fmod, nullptr = fmod //
+    // spectrum and waveform are not available for software mixer players //
+    static void setSoftwareMixer( ofxMultiSpeakerMixer* amixer ) { sSoftwareMixer = amixer; }
+    static ofxMultiSpeakerMixer* getSoftwareMixer() { return sSoftwareMixer; }
+    
+    // shared b-format bus, ambisonic players encode into it and one decoder dsp renders it to the speaker mode //
+    // software mixer players use the mixer's own bus, see ofxMultiSpeakerMixer::Settings::bAmbisonicBus //
+    static bool setupAmbisonicBus( ofxMultiSpeakerAmbisonics::Settings asettings );
+    static void closeAmbisonicBus();
+    static bool isAmbisonicBusSetup() { return sAmbisonicBus.group != nullptr; }
+    // group the fmod channels of ambisonic players play into, nullptr when there is no bus //
+    static FMOD_CHANNELGROUP* getAmbisonicBusGroup() { return sAmbisonicBus.group; }
+    // 0 when there is no bus //
+    static int getAmbisonicBusOrder() { return sAmbisonicBus.group != nullptr ? sAmbisonicBus.settings.order : 0; }
+    
+    static void setMasterSpectrumSettings( SpectrumSettings asettings );
+    static SpectrumSettings getMasterSpectrumSettings() { return sMasterSpectrum.settings; }
+    // spectrum of the master output for only the given speakers, all speakers if empty //
+    static std::vector<float> getSpeakerSpectrum( std::vector<FMOD_SPEAKER> aspeakers, int nBands );
 
+    // players register in shared lists without locking, so create, move and destroy them on the thread that calls updateSound() //
     ofxMultiSpeakerSoundPlayer();
     ~ofxMultiSpeakerSoundPlayer();
+    // players can be moved, ie. kept in a std::vector. The moved to player takes over the sound, the id and any batched changes //
+    ofxMultiSpeakerSoundPlayer( ofxMultiSpeakerSoundPlayer&& aother );
+    ofxMultiSpeakerSoundPlayer& operator=( ofxMultiSpeakerSoundPlayer&& aother );
 
     static void updateSound();
+    
+    // the governor samples the mixer cpu in updateSound(). Over the ceiling it bypasses the spectrum dsps, //
+    // then, with bVol0BecomesVirtual, mutes the least important voices so fmod makes them virtual. //
+    // Steps are undone in reverse when the load falls //
+    static void setGovernorSettings( GovernorSettings asettings ) { sGovernorSettings = asettings; }
+    static GovernorSettings getGovernorSettings() { return sGovernorSettings; }
+    static GovernorState getGovernorState() { return sGovernorState; }
+    // every adjustment the governor made, oldest first, the last 100 are kept //
+    static const std::vector<GovernorAdjustment>& getGovernorAdjustments() { return sGovernorAdjustments; }
+    // setVolume, setPan and setSpeed calls after beginBatch() are only recorded, commitBatch() applies them //
+    // for all players at once, with one isPlaying() check per player instead of per call. updateSound() commits an open batch //
+    static void beginBatch();
+    static void commitBatch();
+    static bool isBatching() { return sBBatching; }
+    static VoiceStats getVoiceStats();
+    
+    // queues a cue from any thread without locking, returns false when the queue is full. //
+    // updateSound() drains the queue and starts each cue on the dsp clock at timestamp + delay + latencySeconds //
+    static bool trigger( const Cue& acue );
+    static bool trigger( uint32_t aplayerId, float again = 1.0f, float apan = 0.0f, float adelay = 0.0f );
+    // nanoseconds on the clock cue timestamps use //
+    static uint64_t getCueTime();
+    static void setCueSettings( CueSettings asettings ) { sCueSettings = asettings; }
+    static CueSettings getCueSettings() { return sCueSettings; }
+    static CueStats getCueStats();
     static int getNumberOfDrivers();
     static void printDriverList();
     static std::vector<Driver> getDriverList();
@@ -81,6 +294,14 @@ public:
     bool load(const std::filesystem::path& fileName, bool stream = false) override;
     void unload() override;
     void play() override;
+    // opens a paused channel with volume, pan, speed and loop applied, play() then only has to unpause it //
+    bool prepare();
+    // true once prepare() has a channel ready and any stream buffering is done //
+    bool isPrepared() const;
+    // starts on an exact sample of the master group clock, prepares first if needed //
+    void playAtDSPClock( unsigned long long aclock );
+    // clock of the software mixer when one is set, otherwise of the fmod master group //
+    static unsigned long long getDSPClock();
 //    void playTo(SpeakerPair aSpeakerPair);
     void stop() override;
 
@@ -102,35 +323,196 @@ public:
     float getVolume() const override;
     bool isLoaded() const override;
 
+    // builds the waveform overview on a worker thread, it is kept until the sound is unloaded //
+    bool buildWaveform( WaveformSettings asettings );
+    bool buildWaveform() { return buildWaveform( WaveformSettings() ); }
+    bool isWaveformReady();
+    // nullptr until the worker has finished //
+    std::shared_ptr<const Waveform> getWaveform();
+    // the most detailed level with at least asamplesPerBin frames per bin, nullptr if not ready //
+    const WaveformLevel* getWaveformLevel( int asamplesPerBin );
+    
+    void setPriority( int apriority );
+    int getPriority() const { return priority; }
+    // true when the gains after setPan are under the audibility threshold in every speaker //
+    bool isCulled() const { return bCulled; }
+    
+    // gain applied on top of the volume, set from the loudness analysis on load //
+    void setNormalizeGain( float again );
+    float getNormalizeGain() const { return normalizeGain; }
+    
+    bool isUsingSoftwareMixer() const;
+    
+    // unique for the lifetime of the app, used to address the player from other threads, see trigger() //
+    uint32_t getId() const { return mId; }
+    
+    // gains per FMOD_SPEAKER for a pan position between the player's speakers //
+    void computeSpeakerGains( float apan, std::vector<float>& aOutGains );
+    // false when the player pans between front left and right only //
+    bool isUsingSpeakerGains() const;
+    
     bool isPanningToAllSpeakers() { return mBPanToAllSpeakers; }
     void setPanToAllSpeakers(bool ab) { mBPanToAllSpeakers = ab; }
+    
+    // ambisonic players are placed by direction and the pan is ignored, multi channel files are spread around it //
+    void setAmbisonic( bool ab );
+    bool isAmbisonic() const { return bAmbisonic; }
+    // degrees, azimuth counter clockwise from the front, elevation positive up //
+    void setDirection( float aazimuth, float aelevation );
+    float getAzimuth() const { return azimuth; }
+    float getElevation() const { return elevation; }
+    // true when the player is ambisonic and its backend has a bus to encode into //
+    bool isUsingAmbisonics() const;
+    
+    void setSpectrumSettings( SpectrumSettings asettings );
+    SpectrumSettings getSpectrumSettings() const { return mSpectrum.settings; }
+    // spectrum of this player's channel, the fft dsp is added to the channel on the first call //
+    const std::vector<float>& getSpectrum( int nBands );
 
     static void initializeFmod();
     static void closeFmod();
+    
+    // shared fmod objects, nullptr until initializeFmod() has been called //
+    static FMOD_SYSTEM* getSystem();
+    static FMOD_CHANNELGROUP* getMasterChannelGroup();
+    
+    // converts raw pcm from FMOD_Sound_ReadData or FMOD_Sound_Lock to float, returns the number of samples written //
+    static size_t convertPCMToFloat( const void* adata, unsigned int anumBytes, FMOD_SOUND_FORMAT aformat, float* aOut );
+    // decodes a whole file into interleaved float samples, with adecodeSystem or the shared system if nullptr //
+    static bool loadPCMFloat( std::string aFilePath, std::vector<float>& aOutSamples, int& aOutNumChannels, float& aOutSampleRate, FMOD_SYSTEM* adecodeSystem = nullptr );
 
 protected:
+    // reads the fft of an analyzer whose dsp has been created, un-bypassing it if needed. Only channels in achannels are used, all if empty //
+    static bool readSpectrum( SpectrumAnalyzer& aAnalyzer, const std::vector<int>& achannels, int nBands, float* aOutBands );
+    static FMOD_DSP* createSpectrumDSP( SpectrumAnalyzer& aAnalyzer );
+    static void applySpectrumSettings( SpectrumAnalyzer& aAnalyzer );
+    static void updateSpectrumAnalyzers();
+    static void updateGovernor();
+    static bool governorStepDown();
+    static bool governorStepUp();
+    static void applyGovernorVoiceCap();
+    static void reportGovernorAdjustment( std::string adescription );
+    static void processCues();
+    // false if no channel could be opened //
+    bool playCue( const Cue& acue, unsigned long long aclock );
+    static void releaseSpectrumAnalyzer( SpectrumAnalyzer& aAnalyzer );
+    void attachSpectrumToChannel();
+    bool openChannel( bool abPaused );
+    void applyVolume();
+    void applyPan( const float* aspeakerGains );
+    int getAmbisonicOrder() const;
+    // encode gains of every file channel, aOut[ acn * astride + channel ] //
+    void computeAmbisonicGains( int aorder, int anumChannels, float* aOut, int astride ) const;
+    // moves a playing voice in or out of the ambisonic bus //
+    void routeChannel();
+    static FMOD_RESULT F_CALL ambisonicDecodeProcess( FMOD_DSP_STATE* dsp_state, unsigned int length, const FMOD_DSP_BUFFER_ARRAY* inbufferarray, FMOD_DSP_BUFFER_ARRAY* outbufferarray, FMOD_BOOL inputsidle, FMOD_DSP_PROCESS_OPERATION op );
+    
+    enum BatchFlags {
+        BATCH_VOLUME = 1,
+        BATCH_PAN = 2,
+        BATCH_SPEED = 4
+    };
+    
+    struct BatchEntry {
+        ofxMultiSpeakerSoundPlayer* player = nullptr;
+        unsigned int flags = 0;
+    };
+    
+    struct AmbisonicBus {
+        ofxMultiSpeakerAmbisonics::Settings settings;
+        FMOD_CHANNELGROUP* group = nullptr;
+        FMOD_DSP* decoder = nullptr;
+        FMOD_SPEAKERMODE speakerMode = FMOD_SPEAKERMODE_DEFAULT;
+        int numOutputChannels = 0;
+        // only changed while the decoder is not attached //
+        std::vector<float> decoderGains;
+    };
+    
+    // true if the change was recorded in the open batch //
+    bool addToBatch( unsigned int aflags );
+    void applyBatch( unsigned int aflags, const float* aspeakerGains );
+    // speaker gains for anum pan positions ( 0 - 1 ) at once, written as aOut[ speakerSlot * anum + index ] //
+    static void computePanGainsBatch( const float* apans, const float* anumSpeakers, int anum, int amaxSpeakers, float* aOut );
+    static std::shared_ptr<Waveform> computeWaveform( FMOD_SOUND* asound, std::string aStreamPath, WaveformSettings asettings );
+    // drops retired backends whose waveform build is done, abWait waits for all of them //
+    static void releaseRetiredWaveformBuilds( bool abWait );
+    // sets the normalize gain of players whose loudness analysis has finished since they were loaded //
+    static void applyPendingLoudness();
+    // every constructed player, function local so players that are globals in other files can register //
+    static std::vector<ofxMultiSpeakerSoundPlayer*>& getPlayerList();
+    
+    // a backend unloaded while a waveform build was still reading its sound //
+    struct RetiredWaveformBuild {
+        // declared first so it is destroyed after the future has waited for the worker //
+        std::unique_ptr<ofxMultiSpeakerPlayerBackend> backend;
+        std::future<std::shared_ptr<Waveform>> future;
+    };
+
     bool isStreaming = false;
     bool bMultiPlay = false;
     bool bLoop = false;
     bool bLoadedOk = false;
     bool bPaused = false;
+    bool bPrepared = false;
     float pan = 0; // -1 to 1
     float volume = 1.0; // 0 - 1
-    float internalFreq = 44100; // 44100 ?
+    float normalizeGain = 1.0f;
+    // file queued on the loudness analyzer by load( Settings ), empty when there is nothing to wait for //
+    std::string mLoudnessPendingPath = "";
+    float mLoudnessTargetLUFS = -23.0f;
+    float mLoudnessMaxTruePeakDB = -1.0f;
+    // loudest speaker gain from the last setPan //
+    float maxSpeakerGain = 1.0f;
+    int priority = 128;
+    bool bCulled = false;
+    // muted by the governor's real voice cap //
+    bool bGovernorCulled = false;
     float speed = 1; // -n to n, 1 = normal, -1 backwards
     unsigned int length = 0; // in samples;
 
     bool mBPanToAllSpeakers = false;
+    bool bAmbisonic = false;
+    float azimuth = 0.0f;
+    float elevation = 0.0f;
+    int mNumSoundChannels = 1;
 
     FMOD_RESULT result;
-    FMOD_CHANNEL * channel = nullptr;
-    FMOD_SOUND * sound = nullptr;
 
     std::string currentLoaded = "";
     
     std::vector<FMOD_SPEAKER> mSpeakers;
 //    SpeakerPair mSpeakerPair = SPEAKERS_DEFAULT;
     
+    SpectrumAnalyzer mSpectrum;
+    
+    std::future<std::shared_ptr<Waveform>> mWaveformFuture;
+    std::shared_ptr<const Waveform> mWaveform;
+    
+    // created on load, the software mixer when sSoftwareMixer is set, otherwise fmod //
+    std::unique_ptr<ofxMultiSpeakerPlayerBackend> mBackend;
+    
+    // index in sBatch, -1 when not in the open batch //
+    int mBatchIndex = -1;
+    uint32_t mId = 0;
+    
     static FmodSettings sFmodSettings;
+    static SpectrumAnalyzer sMasterSpectrum;
+    static ofxMultiSpeakerLoudness* sLoudnessAnalyzer;
+    static ofxMultiSpeakerMixer* sSoftwareMixer;
+    static AmbisonicBus sAmbisonicBus;
+    static std::vector<BatchEntry> sBatch;
+    static GovernorSettings sGovernorSettings;
+    static GovernorState sGovernorState;
+    static CueSettings sCueSettings;
+    static std::vector<GovernorAdjustment> sGovernorAdjustments;
+    // updateSound() calls to wait before the next adjustment //
+    static int sGovernorHoldUpdates;
+    // the voice cap muted players on the last update //
+    static bool sBGovernorCapActive;
+    // applyGovernorVoiceCap scratch //
+    static std::vector<ofxMultiSpeakerSoundPlayer*> sGovernorRanked;
+    static bool sBBatching;
+    static std::vector<SpectrumAnalyzer*> sSpectrumAnalyzers;
+    static std::vector<RetiredWaveformBuild> sRetiredWaveformBuilds;
     
 };
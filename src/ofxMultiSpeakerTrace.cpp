@@ -0,0 +1,193 @@
+#include "ofxMultiSpeakerTrace.h"
+#include "ofUtils.h"
+#include "ofLog.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+struct ofxMultiSpeakerTrace::ThreadBuffer {
+    std::vector<Event> events;
+    // only the owning thread writes, dump() reads it to know which events are complete //
+    std::atomic<uint64_t> numWritten{0};
+    // cleared events stay in the ring, they are skipped on dump //
+    std::atomic<uint64_t> firstValid{0};
+    int threadId = 0;
+    // guarded by sRegistryMutex //
+    std::string name;
+};
+
+// buffers are never freed, so events of threads that have exited can still be dumped //
+static std::mutex sRegistryMutex;
+static std::vector<std::unique_ptr<ofxMultiSpeakerTrace::ThreadBuffer>> sThreadBuffers;
+static thread_local ofxMultiSpeakerTrace::ThreadBuffer* tThreadBuffer = nullptr;
+// start of the fmod mixer block that is being mixed, only touched on the mixer thread //
+static thread_local uint64_t tMixerBlockStart = 0;
+
+//--------------------
+static std::string escapeJson( const char* astr ) {
+    std::string tout;
+    for( const char* c = astr; c && *c; c++ ) {
+        if( *c == '"' || *c == '\\' ) {
+            tout += '\\';
+            tout += *c;
+        } else if( (unsigned char)*c < 0x20 ) {
+            tout += ' ';
+        } else {
+            tout += *c;
+        }
+    }
+    return tout;
+}
+
+//--------------------
+static std::string getEventName( const char* aname ) {
+    // fmod calls are recorded with their arguments, only keep the function name //
+    std::string tname = escapeJson( aname );
+    size_t tparen = tname.find( '(' );
+    if( tparen != std::string::npos && tparen > 0 ) {
+        tname = tname.substr( 0, tparen );
+    }
+    return tname;
+}
+
+//--------------------
+static std::string formatMicros( uint64_t anano ) {
+    return ofToString( anano / 1000 ) + "." + ofToString( (int)((anano % 1000) / 100) );
+}
+
+//--------------------
+bool ofxMultiSpeakerTrace::isCompiledIn() {
+#ifdef OFX_MULTI_SPEAKER_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+//--------------------
+uint64_t ofxMultiSpeakerTrace::now() {
+    static const auto sEpoch = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - sEpoch ).count();
+}
+
+//--------------------
+ofxMultiSpeakerTrace::ThreadBuffer* ofxMultiSpeakerTrace::getThreadBuffer() {
+    if( tThreadBuffer == nullptr ) {
+        // only once per thread //
+        std::unique_ptr<ThreadBuffer> tbuffer( new ThreadBuffer() );
+        tbuffer->events.resize( EVENTS_PER_THREAD );
+        std::lock_guard<std::mutex> tlock( sRegistryMutex );
+        tbuffer->threadId = (int)sThreadBuffers.size() + 1;
+        tThreadBuffer = tbuffer.get();
+        sThreadBuffers.push_back( std::move(tbuffer) );
+    }
+    return tThreadBuffer;
+}
+
+//--------------------
+void ofxMultiSpeakerTrace::record( const char* aname, const char* acategory, uint64_t astartNanos, uint64_t aendNanos ) {
+    ThreadBuffer* tbuffer = getThreadBuffer();
+    uint64_t tindex = tbuffer->numWritten.load( std::memory_order_relaxed );
+    Event& tevent = tbuffer->events[ tindex & (EVENTS_PER_THREAD-1) ];
+    tevent.name = aname;
+    tevent.category = acategory;
+    tevent.startNanos = astartNanos;
+    tevent.durationNanos = aendNanos > astartNanos ? aendNanos - astartNanos : 0;
+    tbuffer->numWritten.store( tindex+1, std::memory_order_release );
+}
+
+//--------------------
+void ofxMultiSpeakerTrace::setThreadName( std::string aname ) {
+    ThreadBuffer* tbuffer = getThreadBuffer();
+    std::lock_guard<std::mutex> tlock( sRegistryMutex );
+    tbuffer->name = aname;
+}
+
+//--------------------
+FMOD_RESULT F_CALL ofxMultiSpeakerTrace::mixerCallback( FMOD_SYSTEM*, FMOD_SYSTEM_CALLBACK_TYPE atype, void*, void*, void* ) {
+    if( atype == FMOD_SYSTEM_CALLBACK_PREMIX ) {
+        if( tThreadBuffer == nullptr ) {
+            setThreadName( "fmod mixer" );
+        }
+        tMixerBlockStart = now();
+    } else if( atype == FMOD_SYSTEM_CALLBACK_POSTMIX ) {
+        if( tMixerBlockStart > 0 ) {
+            record( "fmod mix block", "mixer", tMixerBlockStart, now() );
+        }
+    }
+    return FMOD_OK;
+}
+
+//--------------------
+bool ofxMultiSpeakerTrace::attachMixerTiming( FMOD_SYSTEM* asystem ) {
+    if( asystem == nullptr ) return false;
+    FMOD_RESULT result = FMOD_System_SetCallback( asystem, mixerCallback, FMOD_SYSTEM_CALLBACK_PREMIX | FMOD_SYSTEM_CALLBACK_POSTMIX );
+    if( result != FMOD_OK ) {
+        ofLogError("ofxMultiSpeakerTrace :: attachMixerTiming : could not set the mixer callbacks: ") << FMOD_ErrorString(result);
+        return false;
+    }
+    return true;
+}
+
+//--------------------
+bool ofxMultiSpeakerTrace::dump( std::string aFilePath ) {
+    if( !isCompiledIn() ) {
+        ofLogWarning("ofxMultiSpeakerTrace :: dump : built without OFX_MULTI_SPEAKER_TRACE, the trace is empty.");
+    }
+
+    string tpath = ofToDataPath( aFilePath );
+    std::ofstream tfile( tpath, std::ios::trunc );
+    if( !tfile.is_open() ) {
+        ofLogError("ofxMultiSpeakerTrace :: dump : could not open ") << tpath;
+        return false;
+    }
+
+    tfile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool bfirst = true;
+    std::vector<Event> tevents;
+
+    // holding the lock only keeps new threads from registering, recording never waits on it //
+    std::lock_guard<std::mutex> tlock( sRegistryMutex );
+    for( auto& tbuffer : sThreadBuffers ) {
+        std::string tthreadName = tbuffer->name.empty() ? "thread " + ofToString(tbuffer->threadId) : tbuffer->name;
+        tfile << (bfirst ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << tbuffer->threadId;
+        tfile << ",\"args\":{\"name\":\"" << escapeJson( tthreadName.c_str() ) << "\"}}";
+        bfirst = false;
+
+        uint64_t tend = tbuffer->numWritten.load( std::memory_order_acquire );
+        uint64_t tbegin = tend > EVENTS_PER_THREAD ? tend - EVENTS_PER_THREAD : 0;
+        tbegin = std::max( tbegin, tbuffer->firstValid.load() );
+        tevents.clear();
+        for( uint64_t i = tbegin; i < tend; i++ ) {
+            tevents.push_back( tbuffer->events[ i & (EVENTS_PER_THREAD-1) ] );
+        }
+        // the owning thread kept recording while we copied, drop the events it may have overwritten //
+        uint64_t tafter = tbuffer->numWritten.load( std::memory_order_acquire );
+        uint64_t tsafe = tafter >= EVENTS_PER_THREAD ? tafter - EVENTS_PER_THREAD + 1 : 0;
+        size_t tskip = tsafe > tbegin ? (size_t)std::min<uint64_t>( tsafe - tbegin, tevents.size() ) : 0;
+
+        for( size_t i = tskip; i < tevents.size(); i++ ) {
+            const Event& tevent = tevents[i];
+            tfile << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << tbuffer->threadId;
+            tfile << ",\"name\":\"" << getEventName( tevent.name ) << "\"";
+            tfile << ",\"cat\":\"" << escapeJson( tevent.category ) << "\"";
+            tfile << ",\"ts\":" << formatMicros( tevent.startNanos );
+            tfile << ",\"dur\":" << formatMicros( tevent.durationNanos ) << "}";
+        }
+    }
+    tfile << "\n]}\n";
+    return tfile.good();
+}
+
+//--------------------
+void ofxMultiSpeakerTrace::clear() {
+    std::lock_guard<std::mutex> tlock( sRegistryMutex );
+    for( auto& tbuffer : sThreadBuffers ) {
+        tbuffer->firstValid.store( tbuffer->numWritten.load() );
+    }
+}
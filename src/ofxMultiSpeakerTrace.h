@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ofConstants.h"
+
+extern "C" {
+#include "fmod.h"
+#include "fmod_errors.h"
+}
+
+// scoped timers for finding hitches, compiled in only when OFX_MULTI_SPEAKER_TRACE is defined //
+// each thread records into its own ring buffer without locking, dump() writes chrome / perfetto trace json //
+// that can be opened in chrome://tracing or ui.perfetto.dev //
+class ofxMultiSpeakerTrace {
+public:
+
+    // per thread, older events are overwritten, must be a power of 2 //
+    static const size_t EVENTS_PER_THREAD = 65536;
+
+    struct Event {
+        const char* name = nullptr;
+        const char* category = nullptr;
+        uint64_t startNanos = 0;
+        uint64_t durationNanos = 0;
+    };
+
+    // times a scope, records when it is destroyed //
+    class Scope {
+    public:
+        Scope( const char* aname, const char* acategory ) : mName(aname), mCategory(acategory), mStart(now()) {}
+        ~Scope() { record( mName, mCategory, mStart, now() ); }
+    protected:
+        const char* mName;
+        const char* mCategory;
+        uint64_t mStart;
+    };
+
+    // one per recording thread, only used in the cpp //
+    struct ThreadBuffer;
+
+    // true when built with OFX_MULTI_SPEAKER_TRACE //
+    static bool isCompiledIn();
+
+    // nanoseconds since the first call //
+    static uint64_t now();
+    // aname and acategory have to stay valid, ie. string literals //
+    static void record( const char* aname, const char* acategory, uint64_t astartNanos, uint64_t aendNanos );
+    static void setThreadName( std::string aname );
+
+    // times every fmod mixer block with the premix and postmix system callbacks //
+    // fmod keeps one system callback, so this replaces any set with FMOD_System_SetCallback //
+    static bool attachMixerTiming( FMOD_SYSTEM* asystem );
+
+    // writes the buffered events of every thread, call from any thread //
+    static bool dump( std::string aFilePath );
+    static void clear();
+
+protected:
+    static ThreadBuffer* getThreadBuffer();
+    static FMOD_RESULT F_CALL mixerCallback( FMOD_SYSTEM* asystem, FMOD_SYSTEM_CALLBACK_TYPE atype, void* acommandData1, void* acommandData2, void* auserData );
+
+};
+
+#ifdef OFX_MULTI_SPEAKER_TRACE
+#define OFX_MS_TRACE_CONCAT_INNER( a, b ) a##b
+#define OFX_MS_TRACE_CONCAT( a, b ) OFX_MS_TRACE_CONCAT_INNER( a, b )
+// times the rest of the enclosing scope //
+#define OFX_MS_TRACE_SCOPE( aname ) ofxMultiSpeakerTrace::Scope OFX_MS_TRACE_CONCAT( tTraceScope, __LINE__ )( aname, "api" )
+// times a single fmod call, the temporary lives until the end of the full expression //
+#define OFX_MS_TRACE_FMOD( acall ) ( ofxMultiSpeakerTrace::Scope( #acall, "fmod" ), ( acall ) )
+#else
+#define OFX_MS_TRACE_SCOPE( aname )
+#define OFX_MS_TRACE_FMOD( acall ) ( acall )
+#endif